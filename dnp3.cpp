@@ -25,6 +25,21 @@
 #include <mutex>
 #include <iostream>
 #include <thread>
+#include <algorithm>
+#include <sstream>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <functional>
+#include <future>
+#include <set>
+#include <unistd.h>
+#include <errno.h>
+#ifdef USE_TLS
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+#include <openssl/err.h>
+#endif
 
 #include "utils.h"
 #include "south_dnp3.h"
@@ -38,9 +53,88 @@ using namespace opendnp3;
 
 using namespace rapidjson;
 
+/**
+ * Pin a thread to a list of CPUs
+ *
+ * @param    thread	The thread
+ * @param    cpus	The CPU list, i.e. "0-3,6"
+ * @param    name	Thread name for log messages
+ * @return		True on success
+ */
+static bool pinThread(pthread_t thread, const string& cpus, const char *name)
+{
+	cpu_set_t cpuSet;
+	CPU_ZERO(&cpuSet);
+
+	int nCpus = std::thread::hardware_concurrency();
+	stringstream ss(cpus);
+	string item;
+	while (std::getline(ss, item, ','))
+	{
+		int first, last;
+		char c;
+		if (item.find('-') != string::npos)
+		{
+			if (sscanf(item.c_str(), "%d-%d%c", &first, &last, &c) != 2)
+			{
+				first = -1;
+			}
+		}
+		else if (sscanf(item.c_str(), "%d%c", &first, &c) == 1)
+		{
+			last = first;
+		}
+		else
+		{
+			first = -1;
+		}
+		if (first < 0 || last < first || (nCpus > 0 && last >= nCpus) || last >= CPU_SETSIZE)
+		{
+			Logger::getLogger()->warn("Invalid CPU list '%s' for %s threads, CPU affinity not set",
+						  cpus.c_str(),
+						  name);
+			return false;
+		}
+		for (int cpu = first; cpu <= last; cpu++)
+		{
+			CPU_SET(cpu, &cpuSet);
+		}
+	}
+
+	int rc = pthread_setaffinity_np(thread, sizeof(cpuSet), &cpuSet);
+	if (rc != 0)
+	{
+		Logger::getLogger()->warn("Unable to set CPU affinity '%s' for %s thread: %s",
+					  cpus.c_str(),
+					  name,
+					  strerror(rc));
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Return the number of DNP3 worker threads to create
+ *
+ * @return	The configured number or the number of CPU cores if 0
+ */
+unsigned int DNP3::getWorkerThreads() const
+{
+	if (m_workerThreads > 0)
+	{
+		return m_workerThreads;
+	}
+	unsigned int cores = std::thread::hardware_concurrency();
+	return cores > 0 ? cores : 1;
+}
+
 /**
  * Start the DNP3 master and connect to configured outstation
  *
+ * An outstation failing to start, i.e. with bad TLS certificates,
+ * is reported and left stopped: the others are started and scanned.
+ * It is started again by the next reconfiguration.
+ *
  * @return	True on success, false otherwise
  */
 bool DNP3::start()
@@ -48,264 +142,1348 @@ bool DNP3::start()
 	this->lockConfig();
 
 	// Save configuration items
-	int nThreads = m_outstations.size();
-	uint16_t masterId = this->getMasterLinkId();
-	bool scanEnabled = this->isScanEnabled();
-	unsigned long applicationTimeout = this->getTimeout();
-	unsigned long scanInterval = this->getOutstationScanInterval();
-	uint32_t logLevels = this->getAppLogLevel();
+	int nThreads = this->getWorkerThreads();
+	string workerCpus = m_workerCpus;
 
 	// Create DNP3 manager object
-	// Set threads and console logging
+	// Set threads, console logging and worker threads CPU affinity
 	asiodnp3::DNP3Manager* manager = 
 		new asiodnp3::DNP3Manager(nThreads,
-					  asiodnp3::Dnp3Logger::Create(true)); // true for file an line reference in debug
+					  asiodnp3::Dnp3Logger::Create(true), // true for file an line reference in debug
+					  [workerCpus]()
+					  {
+						if (!workerCpus.empty())
+						{
+							pinThread(pthread_self(), workerCpus, "DNP3 worker");
+						}
+					  });
 	m_manager = manager;
 
-	// Get TLS enable flag
-	bool enableTLS = m_enable_tls;
-	// Get global TLS certificates from certificate store
-	std::string peerCertificate = m_ca_cert;
-	std::string TLSCertificate = m_certs_pair;
-	std::string TLSCertificateKey = m_certs_pair;
+	// Reconnect strategy outlives the channels
+	if (!m_reconnect)
+	{
+		m_reconnect = asiodnp3::DNP3ReconnectStrategy::Create();
+	}
+	m_reconnect->Configure(m_retryJitter, m_backoffThreshold);
+
+	Logger::getLogger()->info("DNP3 master uses %d worker threads%s%s",
+				  nThreads,
+				  workerCpus.empty() ? "" : " on CPUs ",
+				  workerCpus.c_str());
+
+	// Readings are passed to Fledge by the ingest thread
+	this->startIngest();
 
 	this->unlockConfig();
 
 	Logger::getLogger()->info("Found %d DNP3 TCP outstation configured", m_outstations.size());
 
-	// Iterate outstation array
+	this->lockConfig();
+	std::vector<OutStationTCP *> outstations = m_outstations;
+	this->unlockConfig();
+
+	if (!this->startOutstations(outstations))
+	{
+		size_t failed = std::count_if(outstations.begin(),
+					      outstations.end(),
+					      [](OutStationTCP *o) { return !o->master; });
+		Logger::getLogger()->error("%lu of %lu DNP3 outstations have failed to start, "
+					   "the others are running",
+					   (unsigned long)failed,
+					   (unsigned long)outstations.size());
+	}
+
+	// Periodic outstation scans: the outstations started
+	// are scanned even if others have failed to start
+	this->startScan();
+
+	return true;
+}
+
+/**
+ * Stop master and close outstation connections
+ */
+void DNP3::stop()
+{
+	this->stopScan();
+
+	if (m_manager)
+	{
+		m_manager->Shutdown();
+		delete m_manager;
+		m_manager = NULL;
+	}
+
 	for (OutStationTCP *outstation : m_outstations)
 	{
-		string remoteLabel = "remote_" + to_string(outstation->linkId);
-		std::error_code ec;
-
-		// Connection retry timings: staring with 20 seconds, then up to 5 minutes
-		auto retry = ChannelRetry(TimeDuration::Seconds(20), TimeDuration::Minutes(5));
-
-		// Create TCP channel for outstation
-		std::shared_ptr<IChannel> channel;
-
-		// Use TLS ?:
-		bool useTLS = !outstation->disableTLS;
-		if (!useTLS)
-		{
-			channel =
-				manager->AddTCPClient(m_serviceName + "_" + remoteLabel, // alias in log messages
-					      logLevels, // filter what gets logged
-					      retry, // how connections will be retried
-					      // host names or IP address of remote endpoint
-					      outstation->address, 
-					      // interface adapter on which to attempt the connection (any adapter)
-					      "0.0.0.0",
-					      // wich port the remote endpoint is listening on
-					      outstation->port,
-					      // optional listener interface for monitoring the channel of outstation
-				 	     asiodnp3::DNP3ChannelListener::Create(outstation));
-		
+		if (outstation->application)
+		{
+			outstation->application->RemoveMaster();
+		}
+		outstation->application.reset();
+		outstation->master.reset();
+		outstation->channel.reset();
+		outstation->listener.reset();
+		outstation->connected = false;
+	}
+
+	// No more data from outstations: ingest queued readings
+	this->stopIngest();
+}
+
+/**
+ * Create the channels and the masters of outstations
+ * and connect to them
+ *
+ * As many channels as DNP3 worker threads are started in parallel,
+ * so the time to first data does not grow with the number of
+ * outstations.
+ * Outstations sharing a channel are started in order by the same
+ * thread.
+ *
+ * @param    outstations	The outstations to start
+ * @return			True if all outstations are started
+ */
+bool DNP3::startOutstations(const std::vector<OutStationTCP *>& outstations)
+{
+	// Group outstations by channel
+	std::vector<std::vector<OutStationTCP *>> groups;
+	for (OutStationTCP *o : outstations)
+	{
+		auto it = std::find_if(groups.begin(),
+					groups.end(),
+					[o](const std::vector<OutStationTCP *>& g)
+					{
+						return g.front()->sameEndpoint(*o);
+					});
+		if (it == groups.end())
+		{
+			groups.push_back(std::vector<OutStationTCP *>(1, o));
 		}
-#ifdef USE_TLS
 		else
 		{
-			std::string usePeerCertificate = peerCertificate ;
-			std::string useTLSCertificate = TLSCertificate;
-			std::string useTLSCertificateKey = TLSCertificate;
-			// TLS certsificates: use global seting or per outstation config ?
-			if (!outstation->TLSCAcertificate.empty() &&
-			    !outstation->TLSCAcertificate.empty())
-			{
-				// Use specific outstation certificates
-				string certs_dir = getDataDir() + "/etc/certs/";
-				usePeerCertificate = certs_dir + outstation->TLSCAcertificate;
-				useTLSCertificate = certs_dir + outstation->TLScertificate;
-				useTLSCertificateKey = certs_dir + outstation->TLScertificate;
-			}
-			channel =
-				manager->AddTLSClient(m_serviceName + "_" + remoteLabel, // alias in log messages
-						logLevels, // filter what gets logged
-						retry, // how connections will be retried
-						// host name or IP address of remote endpoint and port
-						{IPEndpoint(outstation->address, outstation->port)},
-						// interface adapter on which to attempt the connection (any adapter)
-						"0.0.0.0",
-						// TLS certificates setup
-					        TLSConfig(usePeerCertificate + ".cert", // Peer certificate CA
-							useTLSCertificate + ".cert",  // TLS public certificate
-							useTLSCertificateKey + ".key"), // TLS certificate private key
-						// optional listener interface for monitoring the channel of outstation
-						asiodnp3::DNP3ChannelListener::Create(outstation),
-						ec);
-			if (ec)
-  			{
-				Logger::getLogger()->error("Unable to create tls client: %s", ec.message().c_str());
-  				return false;
-  			}
-			else
-			{
-				Logger::getLogger()->info("Created TLS client for outstation Id %d: CA %s, cert %s, cert key %s",
-					  outstation->linkId,
-					  (usePeerCertificate + ".cert").c_str(),
-					  (useTLSCertificate + ".cert").c_str(),
-					  (useTLSCertificateKey + ".key").c_str());
-			}
+			it->push_back(o);
 		}
-#endif
-		if (!channel)
+	}
+
+	std::atomic<size_t> nextGroup(0);
+	std::atomic<bool> success(true);
+	auto worker = [this, &groups, &nextGroup, &success]()
+	{
+		size_t g;
+		while ((g = nextGroup++) < groups.size())
 		{
-			return false;
+			for (OutStationTCP *o : groups[g])
+			{
+				if (!this->startOutstation(o))
+				{
+					Logger::getLogger()->error("Failed to start DNP3 TCP outstation "
+								   "%s:%d, Link Id %d",
+								   o->address.c_str(),
+								   o->port,
+								   o->linkId);
+					success = false;
+				}
+			}
 		}
+	};
+
+	// This thread is one of the workers
+	size_t nThreads = std::min(groups.size(), (size_t)this->getWorkerThreads());
+	std::vector<std::future<void>> tasks;
+	for (size_t i = 1; i < nThreads; i++)
+	{
+		tasks.push_back(std::async(std::launch::async, worker));
+	}
+	worker();
+	for (auto& task : tasks)
+	{
+		task.wait();
+	}
+
+	return success;
+}
+
+/**
+ * Create the channel and the master of an outstation
+ * and connect to it
+ *
+ * Outstations with the same address, port and TLS settings
+ * share one channel, with one master per outstation
+ *
+ * @param    outstation		The outstation
+ * @return			True on success, false otherwise
+ */
+bool DNP3::startOutstation(OutStationTCP *outstation)
+{
+	this->lockConfig();
+	auto it = std::find_if(m_outstations.begin(),
+				m_outstations.end(),
+				[outstation](OutStationTCP *o)
+				{
+					return o != outstation &&
+						o->channel &&
+						o->sameEndpoint(*outstation);
+				});
+	if (it != m_outstations.end())
+	{
+		outstation->channel = (*it)->channel;
+		outstation->listener = (*it)->listener;
+	}
+	this->unlockConfig();
 
-		Logger::getLogger()->info("configured DNP3 TCP outstation is: %s:%d, Link Id %d, TLS is %s ",
+	if (outstation->channel)
+	{
+		Logger::getLogger()->info("DNP3 TCP outstation %s:%d, Link Id %d "
+					  "shares an existing channel",
 					  outstation->address.c_str(),
 					  outstation->port,
-					  outstation->linkId,
-					  useTLS ? "true" : "false");
+					  outstation->linkId);
+		outstation->listener->AddOutstation(outstation);
+	}
+	else if (!this->openChannel(outstation))
+	{
+		return false;
+	}
+	return this->startMaster(outstation);
+}
+
+/**
+ * Create the TCP or TLS channel of an outstation
+ *
+ * @param    outstation		The outstation
+ * @return			True on success, false otherwise
+ */
+bool DNP3::openChannel(OutStationTCP *outstation)
+{
+	this->lockConfig();
+	uint32_t logLevels = this->getAppLogLevel();
+	// Retry delays: global setting unless set in the list
+	unsigned long retryMin = outstation->retryMin ? outstation->retryMin : m_retryMin;
+	unsigned long retryMax = std::max(retryMin,
+					  outstation->retryMax ? outstation->retryMax : m_retryMax);
+	// Label with the link ids of all the outstations
+	// configured on the channel, i.e. remote_20-21
+	string remoteLabel = "remote_" + to_string(outstation->linkId);
+	for (OutStationTCP *o : m_outstations)
+	{
+		if (o != outstation && o->sameEndpoint(*outstation))
+		{
+			remoteLabel += "-" + to_string(o->linkId);
+		}
+	}
+	this->unlockConfig();
 
-		// This object contains static configuration for the master, and transport/link layers
-		MasterStackConfig stackConfig;
+	std::error_code ec;
 
-		// you can optionally override these defaults like:
-		// setting the application layer response timeout
-		// or change behaviors on the master
-		stackConfig.master.responseTimeout = TimeDuration::Seconds(applicationTimeout);
+	// Channel listener, passing state to the outstations on the channel
+	auto listener = asiodnp3::DNP3ChannelListener::Create(m_reconnect, remoteLabel);
+	listener->AddOutstation(outstation);
 
-		// Don't perform Integrity Poll outstation at startup
-		stackConfig.master.startupIntegrityClassMask = ClassField::None(); ;
+	// Connection retry timings: from minimum up to maximum delay
+	// with exponential backoff and jitter. The first retry uses the
+	// minimum delay: it is jittered per channel, so that channels
+	// dropped at the same time do not all retry at once.
+	auto retry = ChannelRetry(m_reconnect->Jitter(TimeDuration::Seconds(retryMin)),
+				  TimeDuration::Seconds(retryMax),
+				  *m_reconnect);
 
-		// Override the default link layer settings
-		stackConfig.link.LocalAddr = masterId;  // Master id link
-		stackConfig.link.RemoteAddr = outstation->linkId; // Outstation id link
+	// Create TCP channel for outstation
+	std::shared_ptr<IChannel> channel;
 
-		// Custom SOEHandler object for callback
-		std::shared_ptr<ISOEHandler> SOEHandle =
-			std::make_shared<dnp3SOEHandler>(this, remoteLabel);
-		if (!SOEHandle)
+	// Use TLS ?:
+	bool useTLS = !outstation->disableTLS;
+	if (!useTLS)
+	{
+		channel =
+			m_manager->AddTCPClient(m_serviceName + "_" + remoteLabel, // alias in log messages
+				      logLevels, // filter what gets logged
+				      retry, // how connections will be retried
+				      // host names or IP address of remote endpoint
+				      outstation->address, 
+				      // interface adapter on which to attempt the connection (any adapter)
+				      "0.0.0.0",
+				      // wich port the remote endpoint is listening on
+				      outstation->port,
+				      // optional listener interface for monitoring the channel of outstation
+			 	     listener);
+	
+	}
+#ifdef USE_TLS
+	else
+	{
+		// TLS certificates: global setting or per outstation config
+		const std::string& usePeerCertificate = outstation->peerCertificate;
+		const std::string& useTLSCertificate = outstation->certificate;
+		const std::string& useTLSCertificateKey = outstation->certificate;
+		std::shared_ptr<asiopal::TLSConfig> tlsConfig = this->getTLSConfig(outstation);
+		if (!tlsConfig)
 		{
 			return false;
 		}
-
-		// Create custom MasterApplication
-		auto ma = DNP3MasterApplication::Create();
-
-		// Create a master bound to a particular channel
-		std::shared_ptr<IMaster> master =
-				channel->AddMaster("master_" + to_string(masterId), // alias for logging
-				SOEHandle,  // IOEHandler (interface)
-				ma, // Application (interface)
-				stackConfig); // static stack configuration
-
-		// Check
-		if (!master)
+		channel =
+			m_manager->AddTLSClient(m_serviceName + "_" + remoteLabel, // alias in log messages
+					logLevels, // filter what gets logged
+					retry, // how connections will be retried
+					// host name or IP address of remote endpoint and port
+					{IPEndpoint(outstation->address, outstation->port)},
+					// interface adapter on which to attempt the connection (any adapter)
+					"0.0.0.0",
+					// TLS certificates setup
+					*tlsConfig,
+					// optional listener interface for monitoring the channel of outstation
+					listener,
+					ec);
+		if (ec)
 		{
+			Logger::getLogger()->error("Unable to create tls client: %s", ec.message().c_str());
 			return false;
 		}
+		else
+		{
+			Logger::getLogger()->info("Created TLS client for outstation Id %d: CA %s, cert %s, cert key %s",
+				  outstation->linkId,
+				  (usePeerCertificate + ".cert").c_str(),
+				  (useTLSCertificate + ".cert").c_str(),
+				  (useTLSCertificateKey + ".key").c_str());
+		}
+	}
+#endif
+	if (!channel)
+	{
+		return false;
+	}
 
-		// Pass master and outstation to custom MasterApplication
-		ma->AddMaster(master, outstation);
+	Logger::getLogger()->info("configured DNP3 TCP outstation is: %s:%d, Link Id %d, TLS is %s ",
+				  outstation->address.c_str(),
+				  outstation->port,
+				  outstation->linkId,
+				  useTLS ? "true" : "false");
 
-		// Do an integrity poll (Class 3/2/1/0) once per specified seconds
-		if (scanEnabled)
-		{
-			Logger::getLogger()->info("Outstation id %d scan (Integrity Poll) is enabled",
-						outstation->linkId);
+	this->lockConfig();
+	outstation->channel = channel;
+	outstation->listener = listener;
+	this->unlockConfig();
 
-			master->AddClassScan(ClassField::AllClasses(),
-					     TimeDuration::Seconds(scanInterval));
-		}
+	return true;
+}
+
+#ifdef USE_TLS
+/**
+ * Return the last OpenSSL error message
+ */
+static string sslError()
+{
+	char buffer[256];
+	unsigned long err = ERR_get_error();
+	ERR_clear_error();
+	if (!err)
+	{
+		return "unknown error";
+	}
+	ERR_error_string_n(err, buffer, sizeof(buffer));
+	return buffer;
+}
+
+/**
+ * Load the certificates of a TLS channel as the TLS client does:
+ * the files must hold PEM certificates and key and the key must
+ * match the certificate. Certificates out of their validity period
+ * are reported, the peer decides whether to accept them.
+ *
+ * @param    ca		The peer certificate CA file
+ * @param    cert	The TLS certificate file
+ * @param    key	The TLS private key file
+ * @return		True if the certificates can be used
+ */
+static bool checkCertificates(const string& ca, const string& cert, const string& key)
+{
+	SSL_CTX *ctx = SSL_CTX_new(SSLv23_client_method());
+	if (!ctx)
+	{
+		Logger::getLogger()->error("Unable to check TLS certificates: %s",
+					   sslError().c_str());
+		return false;
+	}
 
-		// Enable the DNP3 master and connect to outstation
-		if (!master->Enable())
+	bool valid = true;
+	if (SSL_CTX_load_verify_locations(ctx, ca.c_str(), NULL) != 1)
+	{
+		Logger::getLogger()->error("TLS CA certificate '%s' is not valid: %s",
+					   ca.c_str(),
+					   sslError().c_str());
+		valid = false;
+	}
+	if (SSL_CTX_use_certificate_chain_file(ctx, cert.c_str()) != 1)
+	{
+		Logger::getLogger()->error("TLS certificate '%s' is not valid: %s",
+					   cert.c_str(),
+					   sslError().c_str());
+		valid = false;
+	}
+	else if (SSL_CTX_use_PrivateKey_file(ctx, key.c_str(), SSL_FILETYPE_PEM) != 1)
+	{
+		Logger::getLogger()->error("TLS private key '%s' is not valid: %s",
+					   key.c_str(),
+					   sslError().c_str());
+		valid = false;
+	}
+	else if (SSL_CTX_check_private_key(ctx) != 1)
+	{
+		Logger::getLogger()->error("TLS private key '%s' does not match certificate '%s'",
+					   key.c_str(),
+					   cert.c_str());
+		ERR_clear_error();
+		valid = false;
+	}
+	else
+	{
+		X509 *x509 = SSL_CTX_get0_certificate(ctx);
+		if (x509 && X509_cmp_current_time(X509_get0_notAfter(x509)) < 0)
 		{
-			return false;
+			Logger::getLogger()->warn("TLS certificate '%s' has expired",
+						  cert.c_str());
+		}
+		else if (x509 && X509_cmp_current_time(X509_get0_notBefore(x509)) > 0)
+		{
+			Logger::getLogger()->warn("TLS certificate '%s' is not valid yet",
+						  cert.c_str());
 		}
 	}
 
-	// Success
-	return true;
+	SSL_CTX_free(ctx);
+	return valid;
 }
 
 /**
- * Set plugin configuration
+ * Return the TLS configuration of the outstation certificates
  *
- * @param	config	The configuration category
- * @return		True on success, false on errors
+ * Certificates are checked once per set of certificates
+ * and the configuration is shared by all the channels using them.
+ *
+ * @param    outstation		The outstation
+ * @return			The TLS configuration, NULL if
+ *				certificates cannot be read or used
  */
-bool DNP3::configure(ConfigCategory* config)
+std::shared_ptr<asiopal::TLSConfig> DNP3::getTLSConfig(const OutStationTCP *outstation)
 {
-	string certs_dir = getDataDir() + "/etc/certs/";
+	string key = outstation->peerCertificate + "\n" + outstation->certificate;
 
-	this->lockConfig();
+	std::lock_guard<std::mutex> guard(m_tlsMutex);
+	auto it = m_tlsConfigs.find(key);
+	if (it != m_tlsConfigs.end())
+	{
+		return it->second;
+	}
 
-	m_enable_tls = config->itemExists("enableTLS") &&
-			 (config->getValue("enableTLS").compare("true") == 0 ||
-			  config->getValue("enableTLS").compare("True") == 0);
-	if (m_enable_tls)
+	// Peer certificate CA, TLS public certificate and private key
+	string files[] = { outstation->peerCertificate + ".cert",
+			   outstation->certificate + ".cert",
+			   outstation->certificate + ".key" };
+	bool valid = true;
+	for (auto& file : files)
 	{
-		if (config->itemExists("TLSCAcertificate") &&
-		    config->itemExists("TLScertificate"))
+		if (access(file.c_str(), R_OK) != 0)
 		{
-			string ca_cert = config->getValue("TLSCAcertificate");
-			string certs_pair = config->getValue("TLScertificate");
-			if (ca_cert.empty() ||
-			    certs_pair.empty())
-			{
-                                Logger::getLogger()->error("TLS is enabled but all certificates names are not set");
-				return false;
-			}
-			m_ca_cert = certs_dir + ca_cert;
-			m_certs_pair = certs_dir + certs_pair;
+			Logger::getLogger()->error("TLS certificate file '%s' cannot be read: %s",
+						   file.c_str(),
+						   strerror(errno));
+			valid = false;
 		}
 	}
-	auto it = m_outstations.begin();
-	while (it != m_outstations.end())
+
+	std::shared_ptr<asiopal::TLSConfig> config;
+	if (valid && checkCertificates(files[0], files[1], files[2]))
 	{
-		it = m_outstations.erase(it);
+		config = std::make_shared<asiopal::TLSConfig>(files[0], files[1], files[2]);
 	}
+	m_tlsConfigs[key] = config;
 
-	if (config->itemExists("asset"))
+	return config;
+}
+
+/**
+ * Remove the checked TLS configurations:
+ * certificates are checked again when next used
+ */
+void DNP3::clearTLSConfigs()
+{
+	std::lock_guard<std::mutex> guard(m_tlsMutex);
+	m_tlsConfigs.clear();
+}
+#endif
+
+/**
+ * Create the master of an outstation on the outstation channel
+ * and enable it
+ *
+ * @param    outstation		The outstation
+ * @return			True on success, false otherwise
+ */
+bool DNP3::startMaster(OutStationTCP *outstation)
+{
+	this->lockConfig();
+	uint16_t masterId = this->getMasterLinkId();
+	unsigned long applicationTimeout = this->getTimeout();
+	bool scanEnabled = this->isScanEnabled();
+	this->unlockConfig();
+
+	string remoteLabel = "remote_" + to_string(outstation->linkId);
+
+	// This object contains static configuration for the master, and transport/link layers
+	MasterStackConfig stackConfig;
+
+	// you can optionally override these defaults like:
+	// setting the application layer response timeout
+	// or change behaviors on the master
+	stackConfig.master.responseTimeout = TimeDuration::Seconds(applicationTimeout);
+
+	if (outstation->unsolicited)
 	{
-		this->setAssetName(config->getValue("asset"));
+		// Integrity Poll at startup and on event buffer overflow,
+		// then enable unsolicited Class 1/2/3 events
+		stackConfig.master.startupIntegrityClassMask = ClassField::AllClasses();
+		stackConfig.master.integrityOnEventOverflowIIN = true;
+		stackConfig.master.disableUnsolOnStartup = true;
+		stackConfig.master.unsolClassMask = ClassField::AllEventClasses();
 	}
-	else    
+	else
 	{
-		this->setAssetName(DEFAULT_ASSETNAME_PREFIX);
+		// Don't perform Integrity Poll outstation at startup:
+		// the scan thread does it once the channel is open
+		stackConfig.master.startupIntegrityClassMask = ClassField::None();
+		// Integrity Poll on event buffer overflow is requested
+		// to the scan thread by the master application
+		stackConfig.master.integrityOnEventOverflowIIN = false;
 	}
-        
-	if (config->itemExists("master_id"))
+
+	// Override the default link layer settings
+	stackConfig.link.LocalAddr = masterId;  // Master id link
+	stackConfig.link.RemoteAddr = outstation->linkId; // Outstation id link
+
+	// Custom SOEHandler object for callback
+	std::shared_ptr<ISOEHandler> SOEHandle =
+		std::make_shared<dnp3SOEHandler>(this, remoteLabel, outstation);
+	if (!SOEHandle)
 	{
-		this->setMasterLinkId((uint16_t)atoi(config->getValue("master_id").c_str()));
+		return false;
 	}
-	else    
-	{       
-		this->setMasterLinkId((uint16_t)atoi(DEFAULT_MASTER_LINK_ID));
+
+	// Create custom MasterApplication
+	auto ma = DNP3MasterApplication::Create();
+	this->lockConfig();
+	ma->SetClassAssignments(outstation->classAssignments);
+	this->unlockConfig();
+
+	// Create a master bound to a particular channel
+	std::shared_ptr<IMaster> master =
+			outstation->channel->AddMaster("master_" + to_string(masterId) + "_" + remoteLabel, // alias for logging
+			SOEHandle,  // IOEHandler (interface)
+			ma, // Application (interface)
+			stackConfig); // static stack configuration
+
+	// Check
+	if (!master)
+	{
+		return false;
 	}
 
-	bool oneOutstation = true;
-	if (config->itemExists("outstations") && config->isList("outstations"))
+	// Pass master and outstation to custom MasterApplication
+	ma->AddMaster(master, outstation);
+
+	if (outstation->unsolicited)
 	{
-		string outstations = config->getValue("outstations");
-		Document document;
-		if (document.Parse(outstations.c_str()).HasParseError())
-		{
-			Logger::getLogger()->error("Error while parsing '%s' type 'list' item: %s",
-					"outstations",
-					GetParseError_En(document.GetParseError()));
-			return false;
-		}
-		if (!document.IsArray())
-		{
-			Logger::getLogger()->error("Error '%s' type 'list' item is not an array",
-					"outstations");
-			return false;
-		}
-		for (auto& o : document.GetArray())
-		{
-			if (!o.IsObject())
-			{
-				Logger::getLogger()->error("Error '%s' type 'list': array element is not an object",
-						"outstations");
-				return false;
+		Logger::getLogger()->info("Outstation id %d uses unsolicited events",
+					outstation->linkId);
+	}
+	// Do an integrity poll (Class 3/2/1/0) once per specified seconds
+	else if (scanEnabled)
+	{
+		Logger::getLogger()->info("Outstation id %d scan (Integrity Poll) is enabled",
+					outstation->linkId);
+	}
+
+	this->lockConfig();
+	outstation->master = master;
+	outstation->application = ma;
+	this->unlockConfig();
+
+	// Enable the DNP3 master and connect to outstation
+	if (!master->Enable())
+	{
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * Shutdown the master of an outstation
+ *
+ * @param    outstation		The outstation
+ */
+void DNP3::stopMaster(OutStationTCP *outstation)
+{
+	this->lockConfig();
+	std::shared_ptr<IMaster> master = outstation->master;
+	std::shared_ptr<DNP3MasterApplication> ma = outstation->application;
+	outstation->master.reset();
+	outstation->application.reset();
+	this->unlockConfig();
+
+	if (master)
+	{
+		master->Shutdown();
+	}
+	if (ma)
+	{
+		// Release the master held by the application
+		ma->RemoveMaster();
+	}
+}
+
+/**
+ * Shutdown the master and the channel of an outstation
+ *
+ * @param    outstation		The outstation
+ */
+void DNP3::stopOutstation(OutStationTCP *outstation)
+{
+	this->stopMaster(outstation);
+
+	this->lockConfig();
+	std::shared_ptr<IChannel> channel = outstation->channel;
+	std::shared_ptr<DNP3ChannelListener> listener = outstation->listener;
+	outstation->channel.reset();
+	outstation->listener.reset();
+	this->unlockConfig();
+
+	// Shutdown the channel when no other outstation uses it
+	if (listener && listener->RemoveOutstation(outstation) == 0 && channel)
+	{
+		channel->Shutdown();
+	}
+	outstation->connected = false;
+}
+
+/**
+ * Apply a new configuration to the running master.
+ *
+ * Only the outstations added, removed or changed in the outstation
+ * list are started or stopped: the others keep their connection.
+ * Changes to the master link id or to the network timeout rebuild
+ * the masters on existing channels, other settings are applied
+ * in place. Thread and queue settings need a full restart.
+ * Kept outstations whose channel or master failed to start
+ * are started again. An invalid configuration is rejected
+ * before any setting is changed.
+ *
+ * @param    config	The new configuration category
+ * @return		True on success, false otherwise
+ */
+bool DNP3::reconfigure(ConfigCategory* config)
+{
+	if (!m_manager)
+	{
+		// Not started
+		return this->configure(config);
+	}
+
+	// Take current outstations and settings
+	this->lockConfig();
+	std::vector<OutStationTCP *> running;
+	running.swap(m_outstations);
+	uint16_t masterId = m_masterId;
+	unsigned long applicationTimeout = m_applicationTimeout;
+	uint32_t logLevels = m_appLogLevel;
+	unsigned int workerThreads = m_workerThreads;
+	string workerCpus = m_workerCpus;
+	string ingestCpus = m_ingestCpus;
+	unsigned long ingestQueueSize = m_ingestQueueSize;
+	this->unlockConfig();
+
+	bool ret = this->configure(config);
+
+	this->lockConfig();
+	if (!ret)
+	{
+		// Keep running configuration
+		for (OutStationTCP *o : m_outstations)
+		{
+			delete o;
+		}
+		m_outstations.swap(running);
+		this->unlockConfig();
+		return false;
+	}
+
+	bool restart = workerThreads != m_workerThreads ||
+			workerCpus != m_workerCpus ||
+			ingestCpus != m_ingestCpus ||
+			ingestQueueSize != m_ingestQueueSize;
+	if (restart)
+	{
+		// Give running outstations back to stop()
+		std::vector<OutStationTCP *> configured;
+		configured.swap(m_outstations);
+		m_outstations.swap(running);
+		this->unlockConfig();
+
+		Logger::getLogger()->info("DNP3 threads configuration has changed, "
+					  "restarting DNP3 master");
+		this->stop();
+
+		this->lockConfig();
+		for (OutStationTCP *o : m_outstations)
+		{
+			delete o;
+		}
+		m_outstations.swap(configured);
+		this->unlockConfig();
+
+		return this->start();
+	}
+
+	bool rebuildMasters = masterId != m_masterId ||
+				applicationTimeout != m_applicationTimeout;
+	bool newLogLevels = logLevels != m_appLogLevel;
+	logLevels = m_appLogLevel;
+
+	// Match configured outstations with running ones
+	std::vector<OutStationTCP *> added;
+	std::vector<OutStationTCP *> kept;
+	std::vector<OutStationTCP *> newMaster;
+	for (size_t i = 0; i < m_outstations.size(); i++)
+	{
+		OutStationTCP *o = m_outstations[i];
+		auto it = std::find_if(running.begin(),
+					running.end(),
+					[o](OutStationTCP *r) { return r->sameChannel(*o); });
+		if (it == running.end())
+		{
+			added.push_back(o);
+		}
+		else
+		{
+			if ((*it)->unsolicited != o->unsolicited ||
+			    (*it)->classAssignments != o->classAssignments)
+			{
+				// Master settings have changed
+				(*it)->unsolicited = o->unsolicited;
+				(*it)->classAssignments = o->classAssignments;
+				newMaster.push_back(*it);
 			}
+			// Keep running outstation with new scan settings:
+			// scans are scheduled again
+			(*it)->integrityInterval = o->integrityInterval;
+			(*it)->eventInterval = o->eventInterval;
+			(*it)->rangeScans = o->rangeScans;
+			(*it)->nextIntegrity = std::chrono::steady_clock::time_point();
+			(*it)->nextEvents = std::chrono::steady_clock::time_point();
+			m_outstations[i] = *it;
+			kept.push_back(*it);
+			running.erase(it);
+			delete o;
+		}
+	}
+
+	// Retry delays of new channels and reconnect limits
+	m_reconnect->Configure(m_retryJitter, m_backoffThreshold);
+
+	// Data settings (names, reading mode) are reloaded by SOE handlers
+	m_dataGeneration++;
+	this->unlockConfig();
+
+	// Outstations no longer configured or with changed channel
+	for (OutStationTCP *o : running)
+	{
+		Logger::getLogger()->info("Stopping outstation %s:%d, Link Id %d",
+					  o->address.c_str(),
+					  o->port,
+					  o->linkId);
+		this->stopOutstation(o);
+		delete o;
+	}
+
+	bool success = true;
+	for (OutStationTCP *o : kept)
+	{
+		if (!o->channel)
+		{
+			// Channel creation has failed: start it as a new one
+			added.push_back(o);
+			continue;
+		}
+		if (newLogLevels)
+		{
+			o->channel->SetLogFilters(openpal::LogFilters(logLevels));
+		}
+		bool changedMaster = std::find(newMaster.begin(),
+					       newMaster.end(),
+					       o) != newMaster.end();
+		// Masters which failed to start are retried
+		if (rebuildMasters || changedMaster || !o->master)
+		{
+			this->stopMaster(o);
+			success = this->startMaster(o) && success;
+			// Channel is already open: scan new master
+			o->scanRequested = true;
+		}
+		else if (newLogLevels && o->master)
+		{
+			o->master->SetLogFilters(openpal::LogFilters(logLevels));
+		}
+	}
+
+	success = this->startOutstations(added) && success;
+
+	Logger::getLogger()->info("DNP3 reconfiguration: %d outstations started, "
+				  "%d stopped, %d kept%s",
+				  added.size(),
+				  running.size(),
+				  kept.size(),
+				  rebuildMasters ? " with new master" : "");
+
+	// Scan settings are used by the scan thread,
+	// started if the master has been started without it
+	this->startScan();
+	m_scanCV.notify_one();
+
+	return success;
+}
+
+/**
+ * Start the outstation scan thread
+ */
+void DNP3::startScan()
+{
+	this->lockConfig();
+	if (!m_scanThread)
+	{
+		m_scanRunning = true;
+		m_scanThread = new std::thread(&DNP3::scanThread, this);
+	}
+	this->unlockConfig();
+}
+
+/**
+ * Stop the outstation scan thread
+ */
+void DNP3::stopScan()
+{
+	this->lockConfig();
+	std::thread *thread = m_scanThread;
+	m_scanThread = NULL;
+	m_scanRunning = false;
+	m_scanCV.notify_one();
+	this->unlockConfig();
+
+	if (thread)
+	{
+		thread->join();
+		delete thread;
+	}
+}
+
+/**
+ * Return the next scan time of a periodic scan slot
+ *
+ * Slots are at epoch + phase + k * period
+ *
+ * @param    epoch	The scan epoch
+ * @param    now	Current time
+ * @param    period	The scan period
+ * @param    phase	The slot phase, less than period
+ * @return		The first slot after now
+ */
+static std::chrono::steady_clock::time_point
+	nextScanSlot(std::chrono::steady_clock::time_point epoch,
+		     std::chrono::steady_clock::time_point now,
+		     std::chrono::milliseconds period,
+		     std::chrono::milliseconds phase)
+{
+	auto start = epoch + phase;
+	if (now < start)
+	{
+		return start;
+	}
+	return start + period * ((now - start) / period + 1);
+}
+
+/**
+ * Return the asset name of a statistics reading of an outstation
+ * or of its channel: the remote address and port tell apart
+ * outstations with the same link id
+ *
+ * @param    prefix	The asset name prefix
+ * @param    label	The outstation or channel label, i.e. remote_20
+ * @param    outstation	The outstation
+ * @param    type	The statistics type, i.e. statistics
+ * @return		The asset name, i.e. dnp3_remote_20_10.0.0.5_20000_statistics
+ */
+static string statisticsAsset(const string& prefix,
+			      const string& label,
+			      const DNP3::OutStationTCP *outstation,
+			      const char *type)
+{
+	return prefix + label + "_" + outstation->address + "_" +
+		to_string(outstation->port) + "_" + type;
+}
+
+/**
+ * Add the changes of the channel statistics since the last sample
+ *
+ * @param    stats	The channel statistics
+ * @param    sample	The last sample of the channel
+ * @param    points	The datapoints to add to
+ */
+static void channelStatistics(const LinkStatistics& stats,
+			      Dnp3CounterSample& sample,
+			      std::vector<Datapoint *>& points)
+{
+	sample.add(points, "bytesRx", stats.channel.numBytesRx);
+	sample.add(points, "bytesTx", stats.channel.numBytesTx);
+	sample.add(points, "framesRx", stats.parser.numLinkFrameRx);
+	sample.add(points, "framesTx", stats.channel.numLinkFrameTx);
+	sample.add(points, "crcErrors", stats.parser.numHeaderCrcError +
+					stats.parser.numBodyCrcError);
+	sample.add(points, "badFrames", stats.parser.numBadLength +
+					stats.parser.numBadFunctionCode +
+					stats.parser.numBadFCV +
+					stats.parser.numBadFCB);
+	sample.add(points, "opens", stats.channel.numOpen);
+	sample.add(points, "openFailures", stats.channel.numOpenFail);
+	sample.add(points, "closes", stats.channel.numClose);
+}
+
+/**
+ * Add the changes of the link and transport statistics
+ * of a master since the last sample
+ *
+ * @param    stats	The master stack statistics
+ * @param    sample	The last sample of the master
+ * @param    points	The datapoints to add to
+ */
+static void stackStatistics(const StackStatistics& stats,
+			    Dnp3CounterSample& sample,
+			    std::vector<Datapoint *>& points)
+{
+	sample.add(points, "unexpectedFrames", stats.link.numUnexpectedFrame);
+	sample.add(points, "unknownSource", stats.link.numUnknownSource);
+	sample.add(points, "unknownDestination", stats.link.numUnknownDestination);
+	sample.add(points, "segmentsRx", stats.transport.rx.numTransportRx);
+	sample.add(points, "segmentsTx", stats.transport.tx.numTransportTx);
+	sample.add(points, "segmentErrors", stats.transport.rx.numTransportErrorRx +
+					    stats.transport.rx.numTransportBufferOverflow);
+	sample.add(points, "segmentsDiscarded", stats.transport.rx.numTransportDiscard +
+						stats.transport.rx.numTransportIgnore);
+}
+
+/**
+ * The outstation scan thread
+ *
+ * If data scan is enabled each connected outstation gets an
+ * integrity poll (Class 3/2/1/0) once per integrity interval and,
+ * if set, an event poll (Class 3/2/1) once per event interval.
+ *
+ * Scans of the outstations are spread over the interval: outstation i
+ * of N scans at phase i * interval / N, so that the polling load
+ * is smooth, also after a restart.
+ * The first integrity poll after the channel is open is spread
+ * in the same way over SCAN_CONNECT_SPREAD seconds at most.
+ *
+ * Integrity and event polls requested by the outstation IIN bits
+ * are done at once, at most every IIN_RECOVERY_INTERVAL seconds,
+ * also if data scan is disabled.
+ *
+ * The statistics reading of each outstation is ingested
+ * once per statistics interval and the channel and link statistics
+ * readings once per link statistics interval, if enabled.
+ * The DNP3 stack statistics are read after releasing the
+ * configuration lock, as reading them waits for the channel thread.
+ *
+ * Outstations using unsolicited events have no class scans.
+ * Range scans of an outstation are done once per range scan period,
+ * spread in the same way, also if data scan is disabled.
+ *
+ * Scan settings are read at each iteration, so changes are
+ * applied without restarting the masters.
+ */
+void DNP3::scanThread()
+{
+	typedef std::chrono::steady_clock::time_point TimePoint;
+	std::unique_lock<std::mutex> lck(m_configMutex);
+	m_scanEpoch = std::chrono::steady_clock::now();
+	m_lastStatistics = m_scanEpoch;
+	m_lastLinkStatistics = m_scanEpoch;
+	while (m_scanRunning)
+	{
+		auto now = std::chrono::steady_clock::now();
+		// Wake up at least once per second to check new connections
+		auto next = now + std::chrono::seconds(1);
+		std::vector<std::function<void()>> due;
+
+		if (m_statisticsInterval &&
+		    now >= m_lastStatistics + std::chrono::seconds(m_statisticsInterval))
+		{
+			double seconds = std::chrono::duration<double>(now - m_lastStatistics).count();
+			m_lastStatistics = now;
+			for (OutStationTCP *o : m_outstations)
+			{
+				// Example: dnp3_remote_20_10.0.0.5_20000_statistics
+				string asset = statisticsAsset(m_asset,
+							       "remote_" + to_string(o->linkId),
+							       o,
+							       "statistics");
+				std::shared_ptr<Dnp3Statistics> stats = o->statistics;
+				due.push_back([this, asset, stats, seconds]()
+				{
+					std::vector<Datapoint *> points = stats->report(seconds);
+					this->ingest(asset, points);
+				});
+			}
+		}
+
+		if (m_linkStatisticsInterval &&
+		    now >= m_lastLinkStatistics + std::chrono::seconds(m_linkStatisticsInterval))
+		{
+			m_lastLinkStatistics = now;
+			// A channel shared by outstations is sampled once
+			std::set<DNP3ChannelListener *> channels;
+			for (OutStationTCP *o : m_outstations)
+			{
+				if (o->listener && channels.insert(o->listener.get()).second)
+				{
+					// Example: dnp3_remote_20-21_10.0.0.5_20000_channel
+					string asset = statisticsAsset(m_asset,
+								       o->listener->Label(),
+								       o,
+								       "channel");
+					std::shared_ptr<IChannel> channel = o->channel;
+					std::shared_ptr<DNP3ChannelListener> listener = o->listener;
+					due.push_back([this, asset, channel, listener]()
+					{
+						std::vector<Datapoint *> points;
+						channelStatistics(channel->GetStatistics(),
+								  listener->ChannelSample(),
+								  points);
+						this->ingest(asset, points);
+					});
+				}
+				if (o->master)
+				{
+					// Example: dnp3_remote_20_10.0.0.5_20000_link
+					string asset = statisticsAsset(m_asset,
+								       "remote_" + to_string(o->linkId),
+								       o,
+								       "link");
+					std::shared_ptr<IMaster> master = o->master;
+					std::shared_ptr<Dnp3LinkStatistics> stats = o->linkStatistics;
+					due.push_back([this, asset, master, stats]()
+					{
+						std::vector<Datapoint *> points;
+						stackStatistics(master->GetStackStatistics(),
+								stats->stack,
+								points);
+						stats->report(points);
+						this->ingest(asset, points);
+					});
+				}
+			}
+		}
+
+		size_t n = m_outstations.size();
+		for (size_t i = 0; i < n; i++)
+		{
+			OutStationTCP *o = m_outstations[i];
+			if (!o->master || !o->connected)
+			{
+				continue;
+			}
+			std::shared_ptr<IMaster> master = o->master;
+
+			for (RangeScan& r : o->rangeScans)
+			{
+				std::chrono::milliseconds period(std::chrono::seconds(r.period));
+				if (r.next == TimePoint() || now >= r.next)
+				{
+					if (r.next != TimePoint())
+					{
+						GroupVariationID id(r.group, r.variation);
+						if (r.allObjects)
+						{
+							due.push_back([master, id]()
+								{ master->ScanAllObjects(id); });
+						}
+						else
+						{
+							uint16_t start = r.start;
+							uint16_t stop = r.stop;
+							due.push_back([master, id, start, stop]()
+								{ master->ScanRange(id, start, stop); });
+						}
+					}
+					r.next = nextScanSlot(m_scanEpoch,
+							      now,
+							      period,
+							      period * i / n);
+				}
+				next = std::min(next, r.next);
+			}
+
+			if (o->unsolicited)
+			{
+				// No class scans: the master polls on IIN bits
+				o->scanRequested = false;
+				o->integrityRequested = false;
+				o->eventsRequested = 0;
+				continue;
+			}
+
+			// Polls requested by the outstation IIN bits,
+			// at most once per IIN_RECOVERY_INTERVAL seconds
+			bool recoverIntegrity = false;
+			uint8_t recoverClasses = 0;
+			if (o->integrityRequested || o->eventsRequested)
+			{
+				auto allowed = o->lastRecovery +
+						std::chrono::seconds(IIN_RECOVERY_INTERVAL);
+				if (o->lastRecovery == TimePoint() || now >= allowed)
+				{
+					recoverIntegrity = o->integrityRequested.exchange(false);
+					recoverClasses = o->eventsRequested.exchange(0);
+					o->lastRecovery = now;
+				}
+				else
+				{
+					next = std::min(next, allowed);
+				}
+			}
+
+			if (!m_enableScan)
+			{
+				// No periodic scans, only the polls requested
+				// by the IIN bits to recover lost or pending data
+				o->scanRequested = false;
+				if (recoverIntegrity)
+				{
+					due.push_back([master]()
+						{ master->ScanClasses(ClassField::AllClasses()); });
+				}
+				else if (recoverClasses)
+				{
+					ClassField classes(recoverClasses);
+					due.push_back([master, classes]()
+						{ master->ScanClasses(classes); });
+				}
+				continue;
+			}
+
+			std::chrono::milliseconds integrity(std::chrono::seconds(
+					std::max(1UL, o->integrityInterval ?
+						 o->integrityInterval : m_outstationScanInterval)));
+			std::chrono::milliseconds events(std::chrono::seconds(
+					o->eventInterval ?
+					o->eventInterval : m_eventScanInterval));
+
+			if (o->scanRequested.exchange(false))
+			{
+				auto spread = std::min(integrity,
+					std::chrono::milliseconds(std::chrono::seconds(SCAN_CONNECT_SPREAD)));
+				o->nextIntegrity = now + spread * i / n;
+			}
+			if (o->nextIntegrity == TimePoint())
+			{
+				o->nextIntegrity = nextScanSlot(m_scanEpoch,
+								now,
+								integrity,
+								integrity * i / n);
+			}
+			if (events.count() && o->nextEvents == TimePoint())
+			{
+				o->nextEvents = nextScanSlot(m_scanEpoch,
+							     now,
+							     events,
+							     events * i / n);
+			}
+
+			if (now >= o->nextIntegrity || recoverIntegrity)
+			{
+				// Integrity poll also returns the events
+				due.push_back([master]()
+					{ master->ScanClasses(ClassField::AllClasses()); });
+				o->nextIntegrity = nextScanSlot(m_scanEpoch,
+								now,
+								integrity,
+								integrity * i / n);
+				if (events.count() && o->nextEvents <= now)
+				{
+					o->nextEvents = nextScanSlot(m_scanEpoch,
+								     now,
+								     events,
+								     events * i / n);
+				}
+			}
+			else if ((events.count() && now >= o->nextEvents) || recoverClasses)
+			{
+				bool periodic = events.count() && now >= o->nextEvents;
+				ClassField classes = periodic ?
+							ClassField::AllEventClasses() :
+							ClassField(recoverClasses);
+				due.push_back([master, classes]()
+					{ master->ScanClasses(classes); });
+				if (periodic)
+				{
+					o->nextEvents = nextScanSlot(m_scanEpoch,
+								     now,
+								     events,
+								     events * i / n);
+				}
+			}
+
+			next = std::min(next, o->nextIntegrity);
+			if (events.count())
+			{
+				next = std::min(next, o->nextEvents);
+			}
+		}
+
+		if (!due.empty())
+		{
+			lck.unlock();
+			for (auto& scan : due)
+			{
+				scan();
+			}
+			lck.lock();
+			continue;
+		}
+
+		m_scanCV.wait_until(lck, next);
+	}
+}
+
+/**
+ * Set plugin configuration
+ *
+ * @param	config	The configuration category
+ * @return		True on success, false on errors
+ */
+bool DNP3::configure(ConfigCategory* config)
+{
+	string certs_dir = getDataDir() + "/etc/certs/";
+
+	// Check the configuration before applying any setting:
+	// on error the running configuration is left untouched
+	bool enable_tls = config->itemExists("enableTLS") &&
+			 (config->getValue("enableTLS").compare("true") == 0 ||
+			  config->getValue("enableTLS").compare("True") == 0);
+	if (enable_tls &&
+	    config->itemExists("TLSCAcertificate") &&
+	    config->itemExists("TLScertificate") &&
+	    (config->getValue("TLSCAcertificate").empty() ||
+	     config->getValue("TLScertificate").empty()))
+	{
+		Logger::getLogger()->error("TLS is enabled but all certificates names are not set");
+		return false;
+	}
+
+	bool hasList = config->itemExists("outstations") && config->isList("outstations");
+	Document document;
+	if (hasList)
+	{
+		string outstations = config->getValue("outstations");
+		if (document.Parse(outstations.c_str()).HasParseError())
+		{
+			Logger::getLogger()->error("Error while parsing '%s' type 'list' item: %s",
+					"outstations",
+					GetParseError_En(document.GetParseError()));
+			return false;
+		}
+		if (!document.IsArray())
+		{
+			Logger::getLogger()->error("Error '%s' type 'list' item is not an array",
+					"outstations");
+			return false;
+		}
+		for (auto& o : document.GetArray())
+		{
+			if (!o.IsObject())
+			{
+				Logger::getLogger()->error("Error '%s' type 'list': array element is not an object",
+						"outstations");
+				return false;
+			}
+		}
+	}
+
+	this->lockConfig();
+
+	m_enable_tls = enable_tls;
+	if (m_enable_tls &&
+	    config->itemExists("TLSCAcertificate") &&
+	    config->itemExists("TLScertificate"))
+	{
+		m_ca_cert = certs_dir + config->getValue("TLSCAcertificate");
+		m_certs_pair = certs_dir + config->getValue("TLScertificate");
+	}
+	auto it = m_outstations.begin();
+	while (it != m_outstations.end())
+	{
+		delete *it;
+		it = m_outstations.erase(it);
+	}
+
+#ifdef USE_TLS
+	// Certificate files may have changed
+	this->clearTLSConfigs();
+#endif
+
+	if (config->itemExists("asset"))
+	{
+		this->setAssetName(config->getValue("asset"));
+	}
+	else    
+	{
+		this->setAssetName(DEFAULT_ASSETNAME_PREFIX);
+	}
+        
+	if (config->itemExists("master_id"))
+	{
+		this->setMasterLinkId((uint16_t)atoi(config->getValue("master_id").c_str()));
+	}
+	else    
+	{       
+		this->setMasterLinkId((uint16_t)atoi(DEFAULT_MASTER_LINK_ID));
+	}
+
+	this->setRetry(config->itemExists("retryMin") ?
+			(unsigned long)atol(config->getValue("retryMin").c_str()) :
+			(unsigned long)atol(DEFAULT_RETRY_MIN),
+		       config->itemExists("retryMax") ?
+			(unsigned long)atol(config->getValue("retryMax").c_str()) :
+			(unsigned long)atol(DEFAULT_RETRY_MAX),
+		       config->itemExists("retryJitter") ?
+			(unsigned int)atoi(config->getValue("retryJitter").c_str()) :
+			(unsigned int)atoi(DEFAULT_RETRY_JITTER),
+		       config->itemExists("backoffThreshold") ?
+			(unsigned int)atoi(config->getValue("backoffThreshold").c_str()) :
+			(unsigned int)atoi(DEFAULT_BACKOFF_THRESHOLD));
+
+	// Default data mode of the outstations
+	this->setUnsolicited(config->itemExists("dataMode") &&
+			     config->getValue("dataMode") == "Unsolicited");
+
+	bool oneOutstation = true;
+	if (hasList)
+	{
+		for (auto& o : document.GetArray())
+		{
 			DNP3::OutStationTCP *outstation = new DNP3::OutStationTCP();
+			// Use global TLS enable flag unless set in the list
+			outstation->disableTLS = !m_enable_tls;
+			// Use global data mode unless set in the list
+			outstation->unsolicited = m_unsolicited;
 			for (auto& v : o.GetObject())
                         {
 				string key = v.name.GetString();
@@ -337,6 +1515,33 @@ bool DNP3::configure(ConfigCategory* config)
 						outstation->disableTLS = !m_enable_tls;
 					}
 				}
+				if (key == "dataMode")
+				{
+					if (value == "Polling")
+					{
+						outstation->unsolicited = false;
+					}
+					if (value == "Unsolicited")
+					{
+						outstation->unsolicited = true;
+					}
+				}
+				if (key == "retryMin")
+				{
+					outstation->retryMin = atol(value.c_str());
+				}
+				if (key == "retryMax")
+				{
+					outstation->retryMax = atol(value.c_str());
+				}
+				if (key == "integrityInterval")
+				{
+					outstation->integrityInterval = atol(value.c_str());
+				}
+				if (key == "eventInterval")
+				{
+					outstation->eventInterval = atol(value.c_str());
+				}
 				if (key == "TLSCAcertificate")
 				{
 					outstation->TLSCAcertificate = value;
@@ -354,79 +1559,599 @@ bool DNP3::configure(ConfigCategory* config)
 		}
 		if (!oneOutstation)
 		{
-			Logger::getLogger()->warn("Using configuration in 'outstations' list item, " \
-						  "ignoring the single outstation configuration ('outstation_id', " \
-						  "'outstation_tcp_address' and 'outstation_tcp_port')");
+			Logger::getLogger()->warn("Using configuration in 'outstations' list item, " \
+						  "ignoring the single outstation configuration ('outstation_id', " \
+						  "'outstation_tcp_address' and 'outstation_tcp_port')");
+		}
+	}
+
+	if (oneOutstation)
+	{
+		DNP3::OutStationTCP *outstation = new DNP3::OutStationTCP();
+		// One outstation: use global TLS enable flag
+		outstation->disableTLS = !m_enable_tls;
+		outstation->unsolicited = m_unsolicited;
+		if (config->itemExists("outstation_id"))
+		{
+			// Overrides link id
+			outstation->linkId = (uint16_t)atoi(config->getValue("outstation_id").c_str());
+		}
+		if (config->itemExists("outstation_tcp_address"))
+		{
+			// Overrides address
+			outstation->address = config->getValue("outstation_tcp_address");
+		}
+		if (config->itemExists("outstation_tcp_port"))
+		{
+			// Overrides port
+			outstation->port = (unsigned short int)atoi(config->getValue("outstation_tcp_port").c_str());
+		}
+		// Add this outstation to the array
+		this->addOutStationTCP(outstation);
+	}
+
+	// TLS certificates: use global setting or per outstation config
+	for (OutStationTCP *o : m_outstations)
+	{
+		if (!o->TLSCAcertificate.empty() &&
+		    !o->TLScertificate.empty())
+		{
+			// Use specific outstation certificates
+			o->peerCertificate = certs_dir + o->TLSCAcertificate;
+			o->certificate = certs_dir + o->TLScertificate;
+		}
+		else
+		{
+			o->peerCertificate = m_ca_cert;
+			o->certificate = m_certs_pair;
+		}
+	}
+
+	// Range scans: added to the outstations with the scan link id
+	if (config->itemExists("rangeScans") && config->isList("rangeScans"))
+	{
+		string items = config->getValue("rangeScans");
+		Document document;
+		if (document.Parse(items.c_str()).HasParseError() ||
+		    !document.IsArray())
+		{
+			Logger::getLogger()->error("Error while parsing '%s' type 'list' item, "
+						   "range scans are not used",
+						   "rangeScans");
+		}
+		else
+		{
+			for (auto& r : document.GetArray())
+			{
+				if (!r.IsObject())
+				{
+					Logger::getLogger()->warn("Error '%s' type 'list': array element "
+								  "is not an object",
+								  "rangeScans");
+					continue;
+				}
+				RangeScan scan;
+				for (auto& v : r.GetObject())
+				{
+					string key = v.name.GetString();
+					string value = config->to_string(v.value);
+					if (key == "linkid")
+					{
+						scan.linkId = (uint16_t)atoi(value.c_str());
+					}
+					if (key == "group")
+					{
+						scan.group = (uint8_t)atoi(value.c_str());
+					}
+					if (key == "variation")
+					{
+						scan.variation = (uint8_t)atoi(value.c_str());
+					}
+					if (key == "start")
+					{
+						scan.start = (uint16_t)atoi(value.c_str());
+					}
+					if (key == "stop")
+					{
+						scan.stop = (uint16_t)atoi(value.c_str());
+					}
+					if (key == "allObjects")
+					{
+						scan.allObjects = value == "true" || value == "True";
+					}
+					if (key == "period")
+					{
+						scan.period = std::max(1L, atol(value.c_str()));
+					}
+				}
+				if (!scan.allObjects && scan.start > scan.stop)
+				{
+					Logger::getLogger()->warn("Ignoring range scan of group %d "
+								  "variation %d with invalid index range",
+								  scan.group,
+								  scan.variation);
+					continue;
+				}
+				bool found = false;
+				for (OutStationTCP *o : m_outstations)
+				{
+					if (o->linkId == scan.linkId)
+					{
+						o->rangeScans.push_back(scan);
+						found = true;
+					}
+				}
+				if (!found)
+				{
+					Logger::getLogger()->warn("Ignoring range scan of group %d "
+								  "variation %d: no outstation with link Id %d",
+								  scan.group,
+								  scan.variation,
+								  scan.linkId);
+				}
+			}
+		}
+	}
+
+	// Class assignments: added to the outstations with the link id
+	if (config->itemExists("classAssignments") && config->isList("classAssignments"))
+	{
+		string items = config->getValue("classAssignments");
+		Document document;
+		if (document.Parse(items.c_str()).HasParseError() ||
+		    !document.IsArray())
+		{
+			Logger::getLogger()->error("Error while parsing '%s' type 'list' item, "
+						   "event classes are not assigned",
+						   "classAssignments");
+		}
+		else
+		{
+			for (auto& c : document.GetArray())
+			{
+				if (!c.IsObject())
+				{
+					Logger::getLogger()->warn("Error '%s' type 'list': array element "
+								  "is not an object",
+								  "classAssignments");
+					continue;
+				}
+				ClassAssignment assignment;
+				for (auto& v : c.GetObject())
+				{
+					string key = v.name.GetString();
+					string value = config->to_string(v.value);
+					if (key == "linkid")
+					{
+						assignment.linkId = (uint16_t)atoi(value.c_str());
+					}
+					if (key == "group")
+					{
+						assignment.group = (uint8_t)atoi(value.c_str());
+					}
+					if (key == "start")
+					{
+						assignment.start = (uint16_t)atoi(value.c_str());
+					}
+					if (key == "stop")
+					{
+						assignment.stop = (uint16_t)atoi(value.c_str());
+					}
+					if (key == "class")
+					{
+						if (value == "Class 0")
+							assignment.clazz = PointClass::Class0;
+						else if (value == "Class 2")
+							assignment.clazz = PointClass::Class2;
+						else if (value == "Class 3")
+							assignment.clazz = PointClass::Class3;
+						else
+							assignment.clazz = PointClass::Class1;
+					}
+				}
+				if (assignment.start > assignment.stop)
+				{
+					Logger::getLogger()->warn("Ignoring class assignment of group %d "
+								  "with invalid index range",
+								  assignment.group);
+					continue;
+				}
+				bool found = false;
+				for (OutStationTCP *o : m_outstations)
+				{
+					if (o->linkId == assignment.linkId)
+					{
+						o->classAssignments.push_back(assignment);
+						found = true;
+					}
+				}
+				if (!found)
+				{
+					Logger::getLogger()->warn("Ignoring class assignment of group %d: "
+								  "no outstation with link Id %d",
+								  assignment.group,
+								  assignment.linkId);
+				}
+			}
+		}
+	}
+
+	bool enableScan = config->itemExists("outstation_scan_enable") &&
+			 (config->getValue("outstation_scan_enable").compare("true") == 0 ||
+			  config->getValue("outstation_scan_enable").compare("True") == 0);
+
+	this->enableScan(enableScan);
+
+	if (config->itemExists("outstation_scan_interval"))
+	{
+		this->setOutstationScanInterval(atol(config->getValue("outstation_scan_interval").c_str()));
+	}
+
+	if (config->itemExists("event_scan_interval"))
+	{
+		this->setEventScanInterval(atol(config->getValue("event_scan_interval").c_str()));
+	}
+
+	if (config->itemExists("data_fetch_timeout"))
+	{
+		this->setTimeout(atol(config->getValue("data_fetch_timeout").c_str()));
+	}
+
+	if (config->itemExists("appLogLevel"))
+	{
+	        int32_t logLevels = levels::NOTHING;
+
+		string appLevel = config->getValue("appLogLevel");
+		if (appLevel == "" || appLevel == "Normal")
+		{
+			logLevels = levels::NORMAL;
+		}
+		if (appLevel == "Data")
+		{
+			logLevels = levels::NORMAL | levels::ALL_APP_COMMS;
+		}
+		if (appLevel == "DataAndLink")
+		{
+			logLevels = levels::NORMAL | levels::ALL_COMMS;
+		}
+		if (appLevel == "All")
+		{
+			logLevels = levels::ALL;
+		}
+		this->setAppLogLevel(logLevels);
+	}
+
+	if (config->itemExists("readingMode"))
+	{
+		string mode = config->getValue("readingMode");
+		if (mode == "Per object header")
+		{
+			this->setReadingMode(ReadingPerHeader);
+		}
+		else if (mode == "Per response")
+		{
+			this->setReadingMode(ReadingPerResponse);
+		}
+		else if (mode == "Per outstation")
+		{
+			this->setReadingMode(ReadingPerOutstation);
+		}
+		else
+		{
+			this->setReadingMode(ReadingPerPoint);
+		}
+	}
+
+	this->setArrayDatapoints(config->itemExists("arrayDatapoints") &&
+				 (config->getValue("arrayDatapoints").compare("true") == 0 ||
+				  config->getValue("arrayDatapoints").compare("True") == 0));
+
+	if (config->itemExists("readingMaxDatapoints"))
+	{
+		this->setMaxReadingDatapoints(atol(config->getValue("readingMaxDatapoints").c_str()));
+	}
+
+	string assetTemplate = DEFAULT_ASSET_NAME_TEMPLATE;
+	string datapointTemplate = DEFAULT_DATAPOINT_NAME_TEMPLATE;
+	if (config->itemExists("assetNameTemplate") &&
+	    !config->getValue("assetNameTemplate").empty())
+	{
+		assetTemplate = config->getValue("assetNameTemplate");
+	}
+	if (config->itemExists("datapointNameTemplate") &&
+	    !config->getValue("datapointNameTemplate").empty())
+	{
+		datapointTemplate = config->getValue("datapointNameTemplate");
+	}
+	// Templates are compiled once here
+	this->setNameTemplates(assetTemplate, datapointTemplate);
+
+	if (config->itemExists("workerThreads"))
+	{
+		this->setWorkerThreads((unsigned int)atoi(config->getValue("workerThreads").c_str()));
+	}
+
+	this->setCpuAffinity(config->itemExists("workerCpuAffinity") ?
+				config->getValue("workerCpuAffinity") : "",
+			     config->itemExists("ingestCpuAffinity") ?
+				config->getValue("ingestCpuAffinity") : "");
+
+	vector<Deadband> deadbands;
+	if (config->itemExists("deadbands") && config->isList("deadbands"))
+	{
+		string items = config->getValue("deadbands");
+		Document document;
+		if (document.Parse(items.c_str()).HasParseError() ||
+		    !document.IsArray())
+		{
+			Logger::getLogger()->error("Error while parsing '%s' type 'list' item, "
+						   "deadbands are not used",
+						   "deadbands");
+		}
+		else
+		{
+			for (auto& d : document.GetArray())
+			{
+				if (!d.IsObject())
+				{
+					Logger::getLogger()->warn("Error '%s' type 'list': array element "
+								  "is not an object",
+								  "deadbands");
+					continue;
+				}
+				Deadband deadband;
+				bool validType = false;
+				for (auto& v : d.GetObject())
+				{
+					string key = v.name.GetString();
+					string value = config->to_string(v.value);
+					if (key == "type")
+					{
+						for (Dnp3ObjectType type : {ObjectAnalog,
+									    ObjectAnalogOutput,
+									    ObjectCounter})
+						{
+							if (value == objectTypeName(type))
+							{
+								deadband.type = type;
+								validType = true;
+							}
+						}
+					}
+					if (key == "start")
+					{
+						deadband.start = (uint16_t)atoi(value.c_str());
+					}
+					if (key == "stop")
+					{
+						deadband.stop = (uint16_t)atoi(value.c_str());
+					}
+					if (key == "absolute")
+					{
+						deadband.absolute = atof(value.c_str());
+					}
+					if (key == "percent")
+					{
+						deadband.percent = atof(value.c_str());
+					}
+				}
+				if (!validType || deadband.start > deadband.stop)
+				{
+					Logger::getLogger()->warn("Ignoring deadband with invalid "
+								  "object type or index range");
+					continue;
+				}
+				deadbands.push_back(deadband);
+			}
+		}
+	}
+	this->setDeadbands(deadbands);
+
+	this->setSuppressUnchanged(config->itemExists("suppressUnchanged") &&
+				   (config->getValue("suppressUnchanged").compare("true") == 0 ||
+				    config->getValue("suppressUnchanged").compare("True") == 0));
+
+	if (config->itemExists("statisticsInterval"))
+	{
+		this->setStatisticsInterval(atol(config->getValue("statisticsInterval").c_str()));
+	}
+
+	if (config->itemExists("linkStatisticsInterval"))
+	{
+		this->setLinkStatisticsInterval(atol(config->getValue("linkStatisticsInterval").c_str()));
+	}
+
+	if (config->itemExists("ingestQueueSize"))
+	{
+		long size = atol(config->getValue("ingestQueueSize").c_str());
+		if (size > 0)
+		{
+			this->setIngestQueueSize(size);
 		}
 	}
 
-	if (oneOutstation)
+	this->unlockConfig();
+
+	return true;
+}
+
+/**
+ * Queue a reading for ingest into Fledge
+ *
+ * This is called by the DNP3 threads: the reading is added
+ * to the ingest queue and the ingest thread passes it to Fledge,
+ * so protocol processing is never delayed by a slow ingest.
+ * If the queue is full the reading is discarded.
+ *
+ * @param    assetName	The asset name, including the prefix
+ * @param    points	The reading datapoints
+ * @param    eventTimes	Event times of the datapoints that are events,
+ *			in milliseconds since the epoch
+ * @param    stats	Statistics the event latencies are recorded in
+ * @return		True if queued, false if discarded
+ */
+bool DNP3::ingest(const std::string& assetName,
+		  std::vector<Datapoint *>&  points,
+		  const std::vector<uint64_t>& eventTimes,
+		  const std::shared_ptr<Dnp3Statistics>& stats)
+{
+	auto fill = [&](QueuedReading& queued)
 	{
-		DNP3::OutStationTCP *outstation = new DNP3::OutStationTCP();
-		// One outstation: use global TLS enable flag
-		outstation->disableTLS = !m_enable_tls;
-		if (config->itemExists("outstation_id"))
+		queued.asset = assetName;
+		queued.points.assign(points.begin(), points.end());
+		queued.eventTimes.assign(eventTimes.begin(), eventTimes.end());
+		if (!eventTimes.empty())
 		{
-			// Overrides link id
-			outstation->linkId = (uint16_t)atoi(config->getValue("outstation_id").c_str());
+			queued.stats = stats;
 		}
-		if (config->itemExists("outstation_tcp_address"))
+	};
+	if (!m_ingestQueue || !m_ingestQueue->emplace(fill))
+	{
+		for (Datapoint *dp : points)
 		{
-			// Overrides address
-			outstation->address = config->getValue("outstation_tcp_address");
+			delete dp;
 		}
-		if (config->itemExists("outstation_tcp_port"))
+		uint64_t dropped = ++m_ingestDropped;
+		// Don't flood the log
+		if ((dropped & (dropped - 1)) == 0)
 		{
-			// Overrides port
-			outstation->port = (unsigned short int)atoi(config->getValue("outstation_tcp_port").c_str());
+			Logger::getLogger()->warn("DNP3 ingest queue is full, "
+						  "%lu readings have been discarded",
+						  (unsigned long)dropped);
 		}
-		// Add this outstation to the array
-		this->addOutStationTCP(outstation);
+		return false;
 	}
 
-	bool enableScan = config->itemExists("outstation_scan_enable") &&
-			 (config->getValue("outstation_scan_enable").compare("true") == 0 ||
-			  config->getValue("outstation_scan_enable").compare("True") == 0);
+	size_t depth = m_ingestQueue->size();
+	size_t peak = m_ingestQueuePeak.load(std::memory_order_relaxed);
+	while (depth > peak &&
+	       !m_ingestQueuePeak.compare_exchange_weak(peak, depth))
+	{
+	}
 
-	this->enableScan(enableScan);
+	// Wake up the ingest thread if it is waiting for data
+	if (m_ingestWaiting)
+	{
+		std::lock_guard<std::mutex> guard(m_ingestMutex);
+		m_ingestCV.notify_one();
+	}
 
-	if (config->itemExists("outstation_scan_interval"))
+	return true;
+}
+
+/**
+ * Create the ingest queue and start the ingest thread
+ */
+void DNP3::startIngest()
+{
+	if (m_ingestThread)
 	{
-		this->setOutstationScanInterval(atol(config->getValue("outstation_scan_interval").c_str()));
+		return;
 	}
 
-	if (config->itemExists("data_fetch_timeout"))
+	m_ingestQueue.reset(new Dnp3Ring<QueuedReading>(m_ingestQueueSize));
+	m_ingestQueuePeak = 0;
+	m_ingestRunning = true;
+	m_ingestThread = new std::thread(&DNP3::ingestThread, this);
+	if (!m_ingestCpus.empty())
 	{
-		this->setTimeout(atol(config->getValue("data_fetch_timeout").c_str()));
+		pinThread(m_ingestThread->native_handle(), m_ingestCpus, "ingest");
 	}
 
-	if (config->itemExists("appLogLevel"))
+	Logger::getLogger()->debug("DNP3 ingest thread started, queue size %lu",
+				   (unsigned long)m_ingestQueue->capacity());
+}
+
+/**
+ * Stop the ingest thread: queued readings are ingested
+ * before the thread exits
+ */
+void DNP3::stopIngest()
+{
+	if (!m_ingestThread)
 	{
-	        int32_t logLevels = levels::NOTHING;
+		return;
+	}
 
-		string appLevel = config->getValue("appLogLevel");
-		if (appLevel == "" || appLevel == "Normal")
+	{
+		std::lock_guard<std::mutex> guard(m_ingestMutex);
+		m_ingestRunning = false;
+		m_ingestCV.notify_one();
+	}
+	m_ingestThread->join();
+	delete m_ingestThread;
+	m_ingestThread = NULL;
+	m_ingestQueue.reset();
+}
+
+/**
+ * The ingest thread: readings are removed from the ingest
+ * queue in batches and passed to Fledge
+ */
+void DNP3::ingestThread()
+{
+	auto lastReport = std::chrono::steady_clock::now();
+
+	while (true)
+	{
+		QueuedReading queued;
+		int n = 0;
+		while (n < INGEST_BATCH_SIZE && m_ingestQueue->pop(queued))
 		{
-			logLevels = levels::NORMAL;
+			// The reading is built as the callback argument and
+			// owns the datapoints: no copy is made
+			(*m_ingest)(m_data, Reading(queued.asset, std::move(queued.points)));
+			if (queued.stats)
+			{
+				// Event time to hand off to Fledge
+				uint64_t nowMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+					std::chrono::system_clock::now().time_since_epoch()).count();
+				for (uint64_t time : queued.eventTimes)
+				{
+					if (nowMs >= time)
+					{
+						queued.stats->eventLatency.record(nowMs - time);
+					}
+				}
+				queued.stats.reset();
+			}
+			n++;
 		}
-		if (appLevel == "Data")
+
+		auto now = std::chrono::steady_clock::now();
+		if (now - lastReport >= std::chrono::seconds(INGEST_QUEUE_REPORT_INTERVAL))
 		{
-			logLevels = levels::NORMAL | levels::ALL_APP_COMMS;
+			Logger::getLogger()->debug("DNP3 ingest queue depth %lu, peak %lu, discarded %lu",
+						   (unsigned long)m_ingestQueue->size(),
+						   (unsigned long)m_ingestQueuePeak.load(),
+						   (unsigned long)m_ingestDropped.load());
+			lastReport = now;
 		}
-		if (appLevel == "DataAndLink")
+
+		if (n == INGEST_BATCH_SIZE)
 		{
-			logLevels = levels::NORMAL | levels::ALL_COMMS;
+			// More data might be queued
+			continue;
 		}
-		if (appLevel == "All")
+
+		if (!m_ingestRunning)
 		{
-			logLevels = levels::ALL;
+			if (m_ingestQueue->empty())
+			{
+				break;
+			}
+			continue;
 		}
-		this->setAppLogLevel(logLevels);
-	}
-
-	this->unlockConfig();
 
-	return true;
+		// Wait for new readings
+		std::unique_lock<std::mutex> lck(m_ingestMutex);
+		m_ingestWaiting = true;
+		if (m_ingestRunning && m_ingestQueue->empty())
+		{
+			m_ingestCV.wait_for(lck, std::chrono::milliseconds(500));
+		}
+		m_ingestWaiting = false;
+	}
 }
 
 /**
@@ -434,205 +2159,488 @@ bool DNP3::configure(ConfigCategory* config)
  * from outstation
  *
  * For each element a routine is called which
- * ingest data into Fledge
+ * creates the datapoint: this is then ingested
+ * alone or batched with the others as per reading mode
+ *
+ * The object type, the datapoint value type and the quality check
+ * are resolved at compile time by Dnp3PointTraits<T>
  *
  * @param    info	HeaderInfo structure
  * @param    valueis	Indexed Object<T> values
- * @param    objectType	The object type
  */
 template<class T> void
 	dnp3SOEHandler::dnp3DataCallback(const HeaderInfo& info,
-					 const ICollection<Indexed<T>>& values,
-					 const string& objectType)
+					 const ICollection<Indexed<T>>& values)
 {       
-	Logger::getLogger()->debug("Callback for outstation (%s) data: "
-				   "object type '%s', # of elements %d",
-				   m_label.c_str(),
-				   objectType.c_str(),
-				   values.Count());
+	const Dnp3ObjectType objectType = Dnp3PointTraits<T>::type;
+	auto start = std::chrono::steady_clock::now();
+
+	this->checkDebug();
+	SOE_DEBUG("Callback for outstation (%s) data: "
+		  "object type '%s', # of elements %d",
+		  m_label.c_str(),
+		  objectTypeName(objectType).c_str(),
+		  values.Count());
+
+	// Datapoints and their event times
+	std::vector<Datapoint *> points;
+	std::vector<uint64_t> times;
+	if (m_readingMode != DNP3::ReadingPerPoint)
+	{
+		points.reserve(values.Count());
+		times.reserve(values.Count());
+		if (m_arrayDatapoints && Dnp3PointTraits<T>::array)
+		{
+			// Contiguous points as array datapoints
+			this->arrayElements<T>(info, values, points, times);
+			this->batchPoints(points, times, objectType);
+			this->updateStatistics(start);
+			return;
+		}
+	}
 
 	// Lambda function for data element
 	auto processData = [&](const Indexed<T>& pair)
 	{
-		this->dataElement<T>(info,
-				     pair.value,
-				     pair.index,
-				     objectType);
+		Datapoint *dp = this->dataElement<T>(info,
+						     pair.value,
+						     pair.index);
+		if (!dp)
+		{
+			return;
+		}
+		uint64_t time = info.isEventVariation ? pair.value.time.value : 0;
+		if (m_readingMode == DNP3::ReadingPerPoint)
+		{
+			this->ingestPoint(dp, time, pair.index, objectType);
+		}
+		else
+		{
+			points.push_back(dp);
+			times.push_back(time);
+		}
 	};
 
 	// Process all elements
 	values.ForeachItem(processData);
+
+	this->batchPoints(points, times, objectType);
+	this->updateStatistics(start);
+}
+
+/**
+ * Process the data elements of an object header as array datapoints
+ *
+ * Each run of points with contiguous indexes becomes one datapoint
+ * with an array of values, named after the first and last index,
+ * i.e. Analog10_19. A point with no contiguous points is a
+ * scalar datapoint as usual.
+ *
+ * The event time of an array datapoint is the oldest event time
+ * of its points.
+ *
+ * @param    info	HeaderInfo structure
+ * @param    values	Indexed Object<T> values
+ * @param    points	Vector the new datapoints are added to
+ * @param    times	Vector the event times of the datapoints are added to
+ */
+template<class T> void
+	dnp3SOEHandler::arrayElements(const HeaderInfo& info,
+				      const ICollection<Indexed<T>>& values,
+				      std::vector<Datapoint *>& points,
+				      std::vector<uint64_t>& times)
+{
+	typedef Dnp3PointTraits<T> Traits;
+
+	std::vector<double> run;
+	run.reserve(values.Count());
+	uint16_t start = 0;
+	uint64_t runTime = 0;
+	T first;
+
+	// Add current run of points as one datapoint
+	auto addRun = [&]()
+	{
+		if (run.size() == 1)
+		{
+			DatapointValue dVal = Traits::toValue(first);
+			points.push_back(new Datapoint(m_names.get(Traits::type, start).datapoint,
+						       dVal));
+		}
+		else if (run.size() > 1)
+		{
+			DatapointValue dVal(run);
+			points.push_back(new Datapoint(m_names.get(Traits::type, start).datapoint +
+							"_" + std::to_string(start + run.size() - 1),
+						       dVal));
+		}
+		if (!run.empty())
+		{
+			times.push_back(runTime);
+		}
+		run.clear();
+		runTime = 0;
+	};
+
+	values.ForeachItem([&](const Indexed<T>& pair)
+	{
+		if (!this->acceptElement<T>(info, pair.value, pair.index))
+		{
+			addRun();
+			return;
+		}
+		if (!run.empty() && pair.index != start + run.size())
+		{
+			addRun();
+		}
+		if (run.empty())
+		{
+			start = pair.index;
+			first = pair.value;
+		}
+		if (info.isEventVariation &&
+		    pair.value.time.value &&
+		    (runTime == 0 || pair.value.time.value < runTime))
+		{
+			runTime = pair.value.time.value;
+		}
+		run.push_back(Traits::toNumber(pair.value));
+	});
+
+	addRun();
 }
 
 /**
  * Process a data element from callback
  *
- * This routine ingests data in Fledge
+ * This routine creates the datapoint to ingest in Fledge
  *
  * @param    info	HeaderInfo structure
  * @param    value	Object<T> value
  * @param    index	Index value of this data
- * @param    objectType	The object type
+ * @return		The new datapoint or NULL if data is skipped
  */
-template<class T> void
+template<class T> Datapoint *
 	dnp3SOEHandler::dataElement(const HeaderInfo& info,
 				    const T& value,
-				    uint16_t index,
-				    const std::string& objectType)
-{
-	Logger::getLogger()->debug("callback for %s, object %s[%d], isEvent %d, "
-				   "flagsValid %d, flags %d, value %s, time %lu",
-				   m_label.c_str(),
-				   objectType.c_str(),
-				   index,
-				   info.isEventVariation,
-				   info.flagsValid,
-				   static_cast<int>(value.flags.value),
-				   ValueToString(value).c_str(),
-				   value.time.value);
-
-	if (m_dnp3)
-	{
-		bool event = info.isEventVariation == true;
-		int flag = static_cast<int>(value.flags.value);
-		bool isBinary = objectType.compare("Binary") == 0 ||
-				objectType.compare("BinaryOutputStatus") == 0;
-
-		// 0x01 means ONLINE for all Objects
-		// STATE is checked for Binary and BinaryOutputStatus objects
-		if (flag == ONLINE_FLAG_ALL_OBJECTS ||
-		    (isBinary &&
-		     (flag & static_cast<uint8_t>(BinaryQuality::STATE))))
-		{
-			std::vector<Datapoint *> points;
-			if (objectType.compare("Analog") == 0 ||
-			    objectType.compare("AnalogOutput") == 0)
-			{
-				double v = strtod(ValueToString(value).c_str(), NULL);
-				DatapointValue dVal(v);
-				// Datapoint name = objectType + index
-				// Example: Counter0, Counter1
-				std::string dataPointName = objectType + std::to_string(index);
-				points.push_back(new Datapoint(dataPointName, dVal));
-			}
-			else if (isBinary ||
-				 objectType.compare("Counter") == 0)
-			{
-				long v = strtol(ValueToString(value).c_str(), NULL, 10);
-				DatapointValue dVal(v);
-				// Datapoint name = objectType + index
-				// Example: Counter0, Counter1
-				std::string dataPointName = objectType + std::to_string(index);
-				points.push_back(new Datapoint(dataPointName, dVal));
-			}
+				    uint16_t index)
+{
+	typedef Dnp3PointTraits<T> Traits;
 
-			if (points.size() > 0)
-			{
-				// Asset name name = im_label + objectType + _ + index
-				// Example: remote_20_Binary_0
-				std::string assetName = m_label + "_" + \
-							objectType + "_"  + \
-							std::to_string(index);
-
-				// Ingest data in Fledge
-				m_dnp3->ingest(assetName, points);
-			}
-		}
+	if (this->acceptElement<T>(info, value, index))
+	{
+		DatapointValue dVal = Traits::toValue(value);
+		// Datapoint name from datapoint name template
+		// Example: Counter0, Counter1
+		return new Datapoint(m_names.get(Traits::type, index).datapoint, dVal);
 	}
+
+	return NULL;
 }
 
 /**
- * Data callback for DoubleBitBinary solicited and usolicited messagess
- * from outstation
- *
- * For each element a routine is called which
- * ingest data into Fledge
+ * Check a data element from callback: quality, deadband
+ * and unchanged static data
  *
  * @param    info	HeaderInfo structure
- * @param    valueis	Indexed Object<T> values
- * @param    objectType	The object type
+ * @param    value	Object<T> value
+ * @param    index	Index value of this data
+ * @return		True if the element is to be ingested
  */
-template<class T> void
-	dnp3SOEHandler::dnp3DataCallbackDBB(const HeaderInfo& info,
-					 const ICollection<Indexed<T>>& values,
-					 const string& objectType)
-{       
-	Logger::getLogger()->debug("DoubleBitBinary Callback for outstation (%s) data: "
-				   "object type '%s', # of elements %d",
-				   m_label.c_str(),
-				   objectType.c_str(),
-				   values.Count());
-	// Lambda function for data element
-	auto processData = [&](const Indexed<T>& pair)
+template<class T> bool
+	dnp3SOEHandler::acceptElement(const HeaderInfo& info,
+				      const T& value,
+				      uint16_t index)
+{
+	typedef Dnp3PointTraits<T> Traits;
+
+	m_received++;
+
+	SOE_DEBUG("callback for %s, object %s[%d], isEvent %d, "
+		  "flagsValid %d, flags %d, value %s, time %lu",
+		  m_label.c_str(),
+		  objectTypeName(Traits::type).c_str(),
+		  index,
+		  info.isEventVariation,
+		  info.flagsValid,
+		  static_cast<int>(value.flags.value),
+		  Traits::toString(value).c_str(),
+		  value.time.value);
+
+	if (m_dnp3 && Traits::isValid(value.flags.value))
 	{
-		this->dataElementDBB<T>(info,
-				     pair.value,
-				     pair.index,
-				     objectType);
-	};
+		// Skip values within the deadband of the last value sent
+		// and unchanged static values
+		if (m_lastValues.isEnabled(Traits::type) &&
+		    !m_lastValues.update(Traits::type,
+					 index,
+					 Traits::toNumber(value),
+					 value.flags.value,
+					 info.isEventVariation))
+		{
+			SOE_DEBUG("%s, object %s[%d]: value %s is unchanged or within the deadband",
+				  m_label.c_str(),
+				  objectTypeName(Traits::type).c_str(),
+				  index,
+				  Traits::toString(value).c_str());
+			m_filtered++;
+			return false;
+		}
+		return true;
+	}
 
-	// Process all elements
-	values.ForeachItem(processData);
+	m_invalid++;
+	return false;
 }
 
 /**
- * Process a DoubleBitBinary data element from callback
+ * Add the point counts and the duration of an object header
+ * callback to the outstation statistics
  *
- * This routine ingests data in Fledge
+ * @param    start	Start time of the callback
+ */
+void dnp3SOEHandler::updateStatistics(std::chrono::steady_clock::time_point start)
+{
+	m_stats->pointsReceived.fetch_add(m_received, std::memory_order_relaxed);
+	if (m_invalid)
+	{
+		m_stats->pointsInvalid.fetch_add(m_invalid, std::memory_order_relaxed);
+	}
+	if (m_filtered)
+	{
+		m_stats->pointsFiltered.fetch_add(m_filtered, std::memory_order_relaxed);
+	}
+	m_received = 0;
+	m_invalid = 0;
+	m_filtered = 0;
+
+	auto elapsed = std::chrono::steady_clock::now() - start;
+	m_stats->callbackTime.record(
+		std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+}
+
+/**
+ * Reload data settings changed by a reconfiguration:
+ * reading mode, asset and datapoint names, deadbands
+ * and unchanged static data suppression
+ */
+void dnp3SOEHandler::reloadConfig()
+{
+	m_dnp3->lockConfig();
+	m_generation = m_dnp3->getDataGeneration();
+	m_readingMode = m_dnp3->getReadingMode();
+	m_maxDatapoints = m_dnp3->getMaxReadingDatapoints();
+	m_arrayDatapoints = m_dnp3->getArrayDatapoints();
+	m_names = NameCache(m_dnp3->getAssetName(),
+			    m_label,
+			    m_outstation->linkId,
+			    m_outstation->address,
+			    m_outstation->port,
+			    m_dnp3->getAssetNameTemplate(),
+			    m_dnp3->getDatapointNameTemplate());
+	// Last values sent are kept
+	m_lastValues.setDeadbands(m_dnp3->getDeadbands());
+	m_lastValues.setSuppressUnchanged(m_dnp3->getSuppressUnchanged());
+	m_dnp3->unlockConfig();
+
+	Logger::getLogger()->debug("Outstation (%s): data settings reloaded",
+				   m_label.c_str());
+}
+
+/**
+ * Check whether data debug messages are logged for the
+ * object header being processed.
  *
- * @param    info	HeaderInfo structure
- * @param    value	Object<T> value
+ * Messages are logged only if the service log level is debug,
+ * up to DATA_DEBUG_MESSAGES_PER_SECOND per second: the number
+ * of messages not logged is reported when the next period starts.
+ */
+void dnp3SOEHandler::checkDebug()
+{
+	m_debug = Logger::getLogger()->getMinLevel() == "debug";
+	if (!m_debug)
+	{
+		return;
+	}
+
+	auto now = std::chrono::steady_clock::now();
+	if (now - m_debugPeriod >= std::chrono::seconds(1))
+	{
+		if (m_debugSuppressed)
+		{
+			Logger::getLogger()->debug("Outstation (%s): %lu data debug messages "
+						   "have not been logged",
+						   m_label.c_str(),
+						   m_debugSuppressed);
+		}
+		m_debugPeriod = now;
+		m_debugBudget = DATA_DEBUG_MESSAGES_PER_SECOND;
+		m_debugSuppressed = 0;
+	}
+}
+
+/**
+ * Ingest a single datapoint reading
+ *
+ * @param    point	The datapoint to ingest
+ * @param    time	Event time in milliseconds since the epoch, 0 if none
  * @param    index	Index value of this data
  * @param    objectType	The object type
  */
-template<class T> void
-	dnp3SOEHandler::dataElementDBB(const HeaderInfo& info,
-				    const T& value,
-				    uint16_t index,
-				    const std::string& objectType)
+void dnp3SOEHandler::ingestPoint(Datapoint* point,
+				 uint64_t time,
+				 uint16_t index,
+				 Dnp3ObjectType objectType)
 {
+	std::vector<Datapoint *> points(1, point);
+	std::vector<uint64_t> times;
+	if (time)
+	{
+		times.push_back(time);
+	}
 
-	Logger::getLogger()->debug("DoubleBitBinary callback for %s, object %s[%d], isEvent %d, "
-				   "flagsValid %d, flags %d, value %s, time %lu",
-				   m_label.c_str(),
-				   objectType.c_str(),
-				   index,
-				   info.isEventVariation,
-				   info.flagsValid,
-				   static_cast<int>(value.flags.value),
-				   ValueToStringDBB(value).c_str(),
-				   value.time.value);
+	// Asset name from asset name template
+	// Example: dnp3_remote_20_Binary_0
+	// Ingest data in Fledge
+	this->ingestReading(m_names.get(objectType, index).asset, points, times);
+}
 
+/**
+ * Handle the datapoints created from an object header
+ * as per configured reading mode:
+ * ingest them now or add them to response batch
+ *
+ * @param    points	The datapoints: vector is emptied
+ * @param    times	The event time of each datapoint: vector is emptied
+ * @param    objectType	The object type
+ */
+void dnp3SOEHandler::batchPoints(std::vector<Datapoint *>& points,
+				 std::vector<uint64_t>& times,
+				 Dnp3ObjectType objectType)
+{
+	if (points.empty())
+	{
+		return;
+	}
 
-	if (m_dnp3)
+	if (m_readingMode == DNP3::ReadingPerHeader)
 	{
-		bool event = info.isEventVariation == true;
-		int flag = static_cast<int>(value.flags.value);
+		// Asset name name = prefix + m_label + _ + objectType
+		// Example: dnp3_remote_20_Binary
+		this->ingestBatch(points, times, m_names.getTypeAsset(objectType));
+		return;
+	}
+
+	// Append to the object type batch of current response
+	std::vector<Datapoint *>& batch = m_responseBatch[objectType];
+	batch.insert(batch.end(), points.begin(), points.end());
+	points.clear();
+	std::vector<uint64_t>& batchTimes = m_responseTimes[objectType];
+	batchTimes.insert(batchTimes.end(), times.begin(), times.end());
+	times.clear();
+}
 
-		// 0x01 means ONLINE for all Objects
-		// STATE is checked for DoubleBitBinary object
-		if (flag & ONLINE_FLAG_ALL_OBJECTS)
+/**
+ * Ingest batched datapoints: one reading is created unless
+ * the maximum number of datapoints per reading is reached
+ * or a datapoint name is repeated, then more readings are created.
+ * Repeated names are several events of the same point or an event
+ * and the static value of a point: the readings keep their order.
+ *
+ * @param    points	The datapoints: vector is emptied
+ * @param    times	The event time of each datapoint: vector is emptied
+ * @param    assetName	The asset name of the readings
+ */
+void dnp3SOEHandler::ingestBatch(std::vector<Datapoint *>& points,
+				 std::vector<uint64_t>& times,
+				 const std::string& assetName)
+{
+	std::vector<size_t> ends = readingGroups(points, m_maxDatapoints);
+	size_t begin = 0;
+	for (size_t end : ends)
+	{
+		// Event times of the reading
+		std::vector<uint64_t> eventTimes;
+		for (size_t i = begin; i < end; i++)
 		{
-			std::vector<Datapoint *> points;
-			if (objectType.compare("DoubleBitBinary") == 0)
+			if (times[i])
 			{
-				// Convert value to string
-				string v = ValueToStringDBB(value);
-				DatapointValue dVal(v);
-				// Datapoint name = objectType + index
-				// Example: Counter0, Counter1
-				std::string dataPointName = objectType + std::to_string(index);
-				points.push_back(new Datapoint(dataPointName, dVal));
-
-				// Asset name name = im_label + objectType + _ + index
-				// Example: remote_20_Binary_0
-				std::string assetName = m_label + "_" + \
-							objectType + "_"  + \
-							std::to_string(index);
-
-				// Ingest data in Fledge
-				m_dnp3->ingest(assetName, points);
+				eventTimes.push_back(times[i]);
 			}
 		}
+		if (ends.size() == 1)
+		{
+			this->ingestReading(assetName, points, eventTimes);
+		}
+		else
+		{
+			std::vector<Datapoint *> chunk(points.begin() + begin,
+						       points.begin() + end);
+			this->ingestReading(assetName, chunk, eventTimes);
+		}
+		begin = end;
+	}
+	points.clear();
+	times.clear();
+}
+
+/**
+ * Ingest a reading and count it in the outstation statistics
+ *
+ * @param    assetName	The asset name
+ * @param    points	The reading datapoints
+ * @param    eventTimes	Event times of the datapoints that are events,
+ *			recorded in the event latency when ingested
+ */
+void dnp3SOEHandler::ingestReading(const std::string& assetName,
+				   std::vector<Datapoint *>& points,
+				   const std::vector<uint64_t>& eventTimes)
+{
+	if (m_dnp3->ingest(assetName, points, eventTimes, m_stats))
+	{
+		m_stats->readings.fetch_add(1, std::memory_order_relaxed);
+	}
+	else
+	{
+		m_stats->readingsDropped.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+/**
+ * Ingest the datapoints batched during current response
+ */
+void dnp3SOEHandler::flushResponse()
+{
+	if (m_readingMode == DNP3::ReadingPerOutstation)
+	{
+		// All the object types in one reading
+		// Example: dnp3_remote_20
+		std::vector<Datapoint *> points;
+		std::vector<uint64_t> times;
+		for (int type = 0; type < ObjectTypes; type++)
+		{
+			std::vector<Datapoint *>& batch = m_responseBatch[type];
+			points.insert(points.end(), batch.begin(), batch.end());
+			batch.clear();
+			std::vector<uint64_t>& batchTimes = m_responseTimes[type];
+			times.insert(times.end(), batchTimes.begin(), batchTimes.end());
+			batchTimes.clear();
+		}
+		if (!points.empty())
+		{
+			this->ingestBatch(points, times, m_names.getOutstationAsset());
+		}
+		return;
+	}
+
+	for (int type = 0; type < ObjectTypes; type++)
+	{
+		if (!m_responseBatch[type].empty())
+		{
+			// Example: dnp3_remote_20_Binary
+			this->ingestBatch(m_responseBatch[type],
+					  m_responseTimes[type],
+					  m_names.getTypeAsset((Dnp3ObjectType)type));
+		}
 	}
 }
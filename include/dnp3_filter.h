@@ -0,0 +1,174 @@
+#ifndef _DNP3_FILTER_H
+#define _DNP3_FILTER_H
+/*
+ * Fledge DNP3 point filtering
+ *
+ * Copyright (c) 2024 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Massimiliano Pinto
+ */
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <cstdint>
+
+#include "dnp3_names.h"
+
+/**
+ * Deadband of an object type, for all points or an index range
+ *
+ * A new value is significant if it differs from the last
+ * value sent by more than the absolute deadband and more than
+ * the percentage deadband of the last value sent.
+ */
+class Deadband
+{
+	public:
+		Deadband() :
+			type(ObjectAnalog),
+			start(0),
+			stop(UINT16_MAX),
+			absolute(0.0),
+			percent(0.0) {};
+
+		bool	contains(uint16_t index) const
+		{
+			return index >= start && index <= stop;
+		};
+		bool	significant(double last, double value) const
+		{
+			double band = std::max(absolute, std::fabs(last) * percent / 100.0);
+			return std::fabs(value - last) > band;
+		};
+
+		Dnp3ObjectType	type;
+		uint16_t	start;
+		uint16_t	stop;
+		double		absolute;
+		double		percent;
+};
+
+/**
+ * Last value and flags sent of each point of an outstation,
+ * kept in contiguous arrays addressed by object type and point index
+ *
+ * The store drops values within the point deadband and, if
+ * enabled, static values equal to the last value sent.
+ */
+class LastValueStore
+{
+	public:
+		LastValueStore() : m_suppressUnchanged(false) {};
+
+		// Set deadbands: only the ones for numeric types are used
+		void	setDeadbands(const std::vector<Deadband>& deadbands)
+		{
+			for (int type = 0; type < ObjectTypes; type++)
+			{
+				m_deadbands[type].clear();
+			}
+			for (auto& deadband : deadbands)
+			{
+				if (deadband.type < ObjectTypes)
+				{
+					m_deadbands[deadband.type].push_back(deadband);
+				}
+			}
+		};
+		// Drop static values that have not changed
+		void	setSuppressUnchanged(bool suppress)
+		{
+			m_suppressUnchanged = suppress;
+		};
+
+		/**
+		 * Check a point value against the last value sent:
+		 * if the value is to be sent it is stored as the last
+		 * value sent.
+		 *
+		 * Events are checked against the deadband only,
+		 * static values also against the last value sent.
+		 *
+		 * @param type		The object type
+		 * @param index		The point index
+		 * @param value		The point value
+		 * @param flags		The point flags
+		 * @param event		True for an event, false for static data
+		 * @return		True if the value is to be sent
+		 */
+		bool	update(Dnp3ObjectType type,
+			       uint16_t index,
+			       double value,
+			       uint8_t flags,
+			       bool event)
+		{
+			std::vector<LastValue>& values = m_values[type];
+			if (index >= values.size())
+			{
+				values.resize(index + 1);
+			}
+
+			LastValue& last = values[index];
+			if (last.valid)
+			{
+				if (m_suppressUnchanged &&
+				    !event &&
+				    last.value == value &&
+				    last.flags == flags)
+				{
+					return false;
+				}
+				const Deadband *deadband = this->deadband(type, index);
+				if (deadband &&
+				    last.flags == flags &&
+				    !deadband->significant(last.value, value))
+				{
+					return false;
+				}
+			}
+
+			last.value = value;
+			last.flags = flags;
+			last.valid = true;
+			return true;
+		};
+
+		// True if values of an object type are to be checked
+		bool	isEnabled(Dnp3ObjectType type) const
+		{
+			return m_suppressUnchanged || !m_deadbands[type].empty();
+		};
+
+	private:
+		// Deadband for a point, NULL if none: the first match is used
+		const Deadband*
+			deadband(Dnp3ObjectType type, uint16_t index) const
+		{
+			for (auto& deadband : m_deadbands[type])
+			{
+				if (deadband.contains(index))
+				{
+					return &deadband;
+				}
+			}
+			return NULL;
+		};
+
+	private:
+		class LastValue
+		{
+			public:
+				LastValue() : value(0.0), flags(0), valid(false) {};
+				double	value;
+				uint8_t	flags;
+				bool	valid;
+		};
+
+		bool			m_suppressUnchanged;
+		std::vector<Deadband>	m_deadbands[ObjectTypes];
+		std::vector<LastValue>	m_values[ObjectTypes];
+};
+
+#endif
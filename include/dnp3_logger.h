@@ -13,6 +13,16 @@
 
 #include <openpal/logging/ILogHandler.h>
 #include <openpal/util/Uncopyable.h>
+#include <string.h>
+#include <unordered_map>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <random>
+
+#include "dnp3_ring.h"
 
 using namespace std;
 using namespace std::chrono;
@@ -22,34 +32,180 @@ namespace asiodnp3
 
 std::ostringstream& operator<<(std::ostringstream& ss, const openpal::LogFilters& filters);
 
+#define DNP3_LOG_QUEUE_SIZE		1024
+#define DNP3_LOG_ID_SIZE		64
+#define DNP3_LOG_LOCATION_SIZE		128
+#define DNP3_LOG_MESSAGE_SIZE		512
+
 /**
  * LogHandler that sends all log messages to Fledge logger system
+ *
+ * Log entries are copied by the DNP3 threads into a preallocated
+ * ring buffer: a background thread formats them and calls the Fledge
+ * logger, so the DNP3 threads never wait for log formatting or writes.
+ * Entries logged while the ring buffer is full are discarded.
  */
 class Dnp3Logger final : public openpal::ILogHandler, private openpal::Uncopyable
 {
+	private:
+		// A log entry copy in the ring buffer
+		class LogSlot
+		{
+			public:
+				// Full logger id: the labels are cached per id
+				const char	*id() const
+				{
+					return longId.empty() ? loggerid : longId.c_str();
+				};
+
+				uint32_t	level;
+				// Logger id, in longId if it does not fit
+				char		loggerid[DNP3_LOG_ID_SIZE];
+				std::string	longId;
+				char		location[DNP3_LOG_LOCATION_SIZE];
+				char		message[DNP3_LOG_MESSAGE_SIZE];
+		};
+
+		// Copy a C string, truncated to the destination size
+		static void copyString(char *dest, const char *src, size_t size)
+		{
+			if (!src)
+			{
+				dest[0] = 0;
+				return;
+			}
+			strncpy(dest, src, size - 1);
+			dest[size - 1] = 0;
+		};
+
 	public:
 		virtual void Log(const openpal::LogEntry& entry) override
 		{
-			ostringstream oss;
-			// Get log level from passd object
-			uint32_t logLevel = entry.filters.GetBitfield();
+			bool queued = m_queue.emplace([&entry](LogSlot& slot)
+			{
+				// Get log level from passd object
+				slot.level = entry.filters.GetBitfield();
+				if (entry.loggerid && strlen(entry.loggerid) >= DNP3_LOG_ID_SIZE)
+				{
+					// Not truncated, so that ids differing
+					// only by their end get their own label
+					slot.loggerid[0] = 0;
+					slot.longId = entry.loggerid;
+				}
+				else
+				{
+					copyString(slot.loggerid, entry.loggerid, DNP3_LOG_ID_SIZE);
+					slot.longId.clear();
+				}
+				copyString(slot.location, entry.location, DNP3_LOG_LOCATION_SIZE);
+				copyString(slot.message, entry.message, DNP3_LOG_MESSAGE_SIZE);
+			});
+			if (!queued)
+			{
+				m_dropped++;
+				return;
+			}
+
+			// Wake up the writer thread, without taking its lock
+			if (m_waiting)
+			{
+				m_cv.notify_one();
+			}
+		};
+
+		static std::shared_ptr<openpal::ILogHandler> Create(bool printLocation = false)
+		{
+			return std::make_shared<Dnp3Logger>(printLocation);
+		};
+
+		Dnp3Logger(bool printLocation) :
+			m_printLocation(printLocation),
+			m_queue(DNP3_LOG_QUEUE_SIZE),
+			m_running(true),
+			m_waiting(false),
+			m_dropped(0)
+		{
+			m_thread = std::thread(&Dnp3Logger::writer, this);
+		};
+
+		~Dnp3Logger()
+		{
+			{
+				std::lock_guard<std::mutex> guard(m_mutex);
+				m_running = false;
+				m_cv.notify_one();
+			}
+			m_thread.join();
+		};
+
+	private:
+		// Writer thread: log the queued entries
+		void writer()
+		{
+			LogSlot slot;
+			while (true)
+			{
+				while (m_queue.pop(slot))
+				{
+					this->write(slot);
+				}
+
+				uint64_t dropped = m_dropped.exchange(0);
+				if (dropped)
+				{
+					Logger::getLogger()->warn("%lu DNP3 log messages have been discarded",
+								  (unsigned long)dropped);
+				}
+
+				if (!m_running)
+				{
+					break;
+				}
+
+				std::unique_lock<std::mutex> lck(m_mutex);
+				m_waiting = true;
+				if (m_running && m_queue.empty())
+				{
+					m_cv.wait_for(lck, std::chrono::milliseconds(100));
+				}
+				m_waiting = false;
+			}
+		};
+
+		// Return the label of a logger id: i.e. "Outstation id 20"
+		// for "service_remote_20" or "master_1_remote_20" and
+		// "Outstation id 20-21" for a shared channel.
+		// Labels are cached per logger id.
+		const string& label(const char *loggerid)
+		{
+			auto it = m_labels.find(loggerid);
+			if (it != m_labels.end())
+			{
+				return it->second;
+			}
 
-			string label = entry.loggerid;
-			int index = label.find("_remote_");
+			string label = loggerid;
+			size_t index = label.find("_remote_");
 			if (index != string::npos)
 			{
-				int tmp = label.find_last_of('_');
+				size_t tmp = label.find_last_of('_');
 				if (tmp != string::npos &&
 				    (tmp+1 < label.length()))
 				{
 					string linkId = label.substr(tmp+1);
-					string sub_str = "Outstation id " + linkId;
-					label.replace(index, sub_str.length(), sub_str);
-					label.erase(0, index);
+					label = "Outstation id " + linkId;
 				}
 			}
 
-			oss << label;
+			return m_labels.insert(std::make_pair(string(loggerid), label)).first->second;
+		};
+
+		// Format a queued entry and send it to Fledge logger
+		void write(LogSlot& slot)
+		{
+			uint32_t logLevel = slot.level;
+
+			string msg = this->label(slot.id());
 
 			// Add file C info for debug/event and unknown levels
 			if (m_printLocation &&
@@ -57,82 +213,245 @@ class Dnp3Logger final : public openpal::ILogHandler, private openpal::Uncopyabl
 			     logLevel != flags::WARN &&
 			     logLevel != flags::INFO))
 			{
-				oss << " - " << entry.location;
+				msg += " - ";
+				msg += slot.location;
 			}
 
-
-			string msg = entry.message;
-			string sub_str = "Connection errored or closed";
-			index = msg.find("End of file");
-			if (index != string::npos)
+			msg += " - ";
+			const char *eof = strstr(slot.message, "End of file");
+			if (eof)
 			{
-				msg.replace(index, sub_str.length(), sub_str);
+				msg.append(slot.message, eof - slot.message);
+				msg += "Connection errored or closed";
+				size_t len = strlen("Connection errored or closed");
+				if (strlen(eof) > len)
+				{
+					msg += eof + len;
+				}
+			}
+			else
+			{
+				msg += slot.message;
 			}
-
-			oss << " - " << msg;
 
 			switch (logLevel)
 			{
 				case flags::ERR:
-					Logger::getLogger()->error(oss.str().c_str());
+					Logger::getLogger()->error("%s", msg.c_str());
 					break;
 				case flags::WARN:
-					Logger::getLogger()->warn(oss.str().c_str());
+					Logger::getLogger()->warn("%s", msg.c_str());
 					break;
 				case flags::INFO:
-					Logger::getLogger()->info(oss.str().c_str());
+					Logger::getLogger()->info("%s", msg.c_str());
 					break;
 				case flags::DBG:
 				case flags::EVENT:
-					Logger::getLogger()->debug(oss.str().c_str());
+					Logger::getLogger()->debug("%s", msg.c_str());
 					break;
 				default:
 					// Unkwon level, log as debug
 					Logger::getLogger()->debug("%s - %s",
 							LogFlagToString(logLevel),
-							oss.str().c_str());
+							msg.c_str());
 					break;
 			}
 		};
 
-		static std::shared_ptr<openpal::ILogHandler> Create(bool printLocation = false)
+	private:
+		bool			m_printLocation;
+		Dnp3Ring<LogSlot>	m_queue;
+		std::thread		m_thread;
+		std::atomic<bool>	m_running;
+		std::atomic<bool>	m_waiting;
+		std::atomic<uint64_t>	m_dropped;
+		std::mutex		m_mutex;
+		std::condition_variable	m_cv;
+		// Labels per logger id, used by writer thread only
+		std::unordered_map<string, string>
+					m_labels;
+};
+
+// Connection retry delays shared by all the outstation channels
+//
+// Exponential backoff with random jitter, so channels closed at the
+// same time do not reconnect at the same time. The minimum delay of
+// each channel is jittered when the channel is created. When more
+// channels than the backoff threshold are connecting, a channel
+// failing to connect waits for the maximum delay.
+//
+// The threshold is not a limit on concurrent connection attempts:
+// opendnp3 channels start their attempts on their own and only
+// the delay after a failure can be set here. The count of connecting
+// channels, which includes channels waiting to retry, is a snapshot
+// taken when a channel fails, so channels failing at the same time
+// may all see the same count.
+class DNP3ReconnectStrategy : public IOpenDelayStrategy
+{
+public:
+	DNP3ReconnectStrategy() : m_jitter(0), m_backoffThreshold(0), m_connecting(0)
+	{
+	}
+
+	static std::shared_ptr<DNP3ReconnectStrategy> Create()
+	{
+		return std::make_shared<DNP3ReconnectStrategy>();
+	}
+
+	// Set jitter in percent of the delay and number of channels
+	// connecting above which the maximum delay is used, 0 for none
+	void Configure(unsigned int jitter, unsigned int backoffThreshold)
+	{
+		m_jitter = jitter;
+		m_backoffThreshold = backoffThreshold;
+	}
+
+	// A channel starts or stops connecting
+	void Connecting(bool connecting)
+	{
+		if (connecting)
 		{
-			return std::make_shared<Dnp3Logger>(printLocation);
-		};
+			m_connecting++;
+		}
+		else
+		{
+			m_connecting--;
+		}
+	}
 
-		Dnp3Logger(bool printLocation) : m_printLocation(printLocation) {};
+	virtual openpal::TimeDuration GetNextDelay(const openpal::TimeDuration& current,
+						   const openpal::TimeDuration& max) const override
+	{
+		int64_t next = std::min(current.GetMilliseconds() * 2, max.GetMilliseconds());
+		unsigned int threshold = m_backoffThreshold;
+		if (threshold && m_connecting.load() > (int)threshold)
+		{
+			next = max.GetMilliseconds();
+		}
+		return this->Jitter(openpal::TimeDuration::Milliseconds(next));
+	}
 
-	private:
-		bool m_printLocation;
+	// Random delay between delay less jitter and delay: also used
+	// for the first retry delay of each channel, which opendnp3
+	// takes from the channel minimum retry delay
+	openpal::TimeDuration Jitter(const openpal::TimeDuration& delay) const
+	{
+		int64_t next = delay.GetMilliseconds();
+		unsigned int jitter = m_jitter;
+		if (jitter && next > 0)
+		{
+			static thread_local std::minstd_rand generator(std::random_device{}());
+			std::uniform_int_distribution<int64_t> distribution(0, next * jitter / 100);
+			next -= distribution(generator);
+		}
+		return openpal::TimeDuration::Milliseconds(next);
+	}
+
+private:
+	std::atomic<unsigned int>	m_jitter;
+	std::atomic<unsigned int>	m_backoffThreshold;
+	std::atomic<int>		m_connecting;
 };
 
 // Outstation channel state listener override class
+//
+// A channel can be shared by several outstations with the same
+// remote endpoint (multi-drop): the state is passed to all of them.
 class DNP3ChannelListener : public IChannelListener
 {
 public:
 	virtual void OnStateChange(opendnp3::ChannelState state) override
 	{
+		bool open = state == opendnp3::ChannelState::OPEN;
 		const char *s = opendnp3::ChannelStateToString(state);
-		Logger::getLogger()->info("Outstation id %d: channel state change for %s:%d is '%s'",
-					m_outstation->linkId,
-					m_outstation->address.c_str(),
-					m_outstation->port,
-				s);
+
+		std::lock_guard<std::mutex> guard(m_mutex);
+		m_open = open;
+		bool opening = state == opendnp3::ChannelState::OPENING;
+		if (opening != m_opening)
+		{
+			m_opening = opening;
+			m_reconnect->Connecting(opening);
+		}
+		for (DNP3::OutStationTCP *o : m_outstations)
+		{
+			if (open && !o->connected)
+			{
+				// Scan outstation as soon as possible
+				o->scanRequested = true;
+			}
+			o->connected = open;
+
+			Logger::getLogger()->info("Outstation id %d: channel state change for %s:%d is '%s'",
+						o->linkId,
+						o->address.c_str(),
+						o->port,
+						s);
+		}
 	}
 
-	// Pass OutStationTCP pointer
-	static std::shared_ptr<DNP3ChannelListener> Create(const DNP3::OutStationTCP *o)
+	static std::shared_ptr<DNP3ChannelListener>
+		Create(std::shared_ptr<DNP3ReconnectStrategy> reconnect,
+		       const std::string& label)
 	{
 		Logger::getLogger()->debug("DNP3ChannelListener::Create() called");
-		return std::make_shared<DNP3ChannelListener>(o);
+		return std::make_shared<DNP3ChannelListener>(reconnect, label);
 	}
 
-	DNP3ChannelListener(const DNP3::OutStationTCP *o)
+	DNP3ChannelListener(std::shared_ptr<DNP3ReconnectStrategy> reconnect,
+			    const std::string& label) :
+		m_open(false),
+		m_opening(false),
+		m_reconnect(reconnect),
+		m_label(label)
 	{
-		m_outstation = (DNP3::OutStationTCP *)o;
 	}
+
+	~DNP3ChannelListener()
+	{
+		if (m_opening)
+		{
+			m_reconnect->Connecting(false);
+		}
+	}
+
+	// Add an outstation using the channel
+	void AddOutstation(DNP3::OutStationTCP *o)
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		m_outstations.push_back(o);
+		if (m_open)
+		{
+			o->connected = true;
+			o->scanRequested = true;
+		}
+	}
+
+	// Remove an outstation and return the number of outstations left
+	size_t RemoveOutstation(DNP3::OutStationTCP *o)
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		m_outstations.erase(std::remove(m_outstations.begin(),
+						m_outstations.end(),
+						o),
+				    m_outstations.end());
+		o->connected = false;
+		return m_outstations.size();
+	}
+
+	// Channel label, i.e. remote_20-21
+	const std::string& Label() const { return m_label; }
+
+	// Last sample of the channel statistics, used by the scan thread
+	Dnp3CounterSample& ChannelSample() { return m_sample; }
 private:
-	DNP3::OutStationTCP	*m_outstation;
+	std::mutex				m_mutex;
+	bool					m_open;
+	bool					m_opening;
+	std::shared_ptr<DNP3ReconnectStrategy>	m_reconnect;
+	std::vector<DNP3::OutStationTCP *>	m_outstations;
+	const std::string			m_label;
+	Dnp3CounterSample			m_sample;
 };
 
 // Master application override class
@@ -154,14 +473,58 @@ public:
 		Logger::getLogger()->debug("DNP3MasterApplication::AddMaster() called");
 	}
 
+	// Set the event classes to assign at startup
+	void SetClassAssignments(const std::vector<DNP3::ClassAssignment>& assignments)
+	{
+		m_assignments = assignments;
+	}
+
+	// Release IMaster pointer after master shutdown
+	void RemoveMaster()
+	{
+		m.reset();
+	}
+
    	// Set here methods overridden in DefaultMasterApplication (set to override final)
 	// opendnp3 library
 	// cpp/libs/src/asiodnp3/DefaultMasterApplication.cpp
 	//
-	// As in DefaultMasterApplication
+	// Assign event classes only if configured for the outstation
 	virtual bool AssignClassDuringStartup() override final
 	{
-		return false;
+		return !m_assignments.empty();
+	}
+
+	/**
+	 * Write the assign class request sent during startup:
+	 * for each class the class header followed by the
+	 * ranges of points assigned to it.
+	 *
+	 * @param fun	The function writing a request header
+	 */
+	virtual void ConfigureAssignClassRequest(const WriteHeaderFunT& fun) override final
+	{
+		for (PointClass clazz : {PointClass::Class0,
+					 PointClass::Class1,
+					 PointClass::Class2,
+					 PointClass::Class3})
+		{
+			bool classHeader = false;
+			for (auto& a : m_assignments)
+			{
+				if (a.clazz != clazz)
+				{
+					continue;
+				}
+				if (!classHeader)
+				{
+					fun(Header::From(clazz));
+					classHeader = true;
+				}
+				// Variation 0: all variations of the group
+				fun(Header::Range16(a.group, 0, a.start, a.stop));
+			}
+		}
 	}
 
 	// As in DefaultMasterApplication
@@ -172,6 +535,76 @@ public:
 		return {time};
 	}
 
+	/**
+	 * Check the IIN bits of each outstation response
+	 *
+	 * Polls needed to recover lost or pending data are
+	 * requested to the scan thread, which rate limits them:
+	 * integrity poll on device restart or event buffer overflow,
+	 * class poll when Class 1/2/3 events are available.
+	 *
+	 * @param iin	The IIN field of the response
+	 */
+	virtual void OnReceiveIIN(const IINField& iin) override
+	{
+		if (iin.IsSet(IINBit::DEVICE_RESTART) ||
+		    iin.IsSet(IINBit::EVENT_BUFFER_OVERFLOW))
+		{
+			if (!m_outstation->integrityRequested.exchange(true))
+			{
+				Logger::getLogger()->info("Outstation id %d reports %s, "
+							  "integrity poll requested",
+							  m_outstation->linkId,
+							  iin.IsSet(IINBit::DEVICE_RESTART) ?
+								"device restart" :
+								"event buffer overflow");
+			}
+		}
+
+		uint8_t classes = 0;
+		if (iin.IsSet(IINBit::CLASS1_EVENTS))
+		{
+			classes |= static_cast<uint8_t>(PointClass::Class1);
+		}
+		if (iin.IsSet(IINBit::CLASS2_EVENTS))
+		{
+			classes |= static_cast<uint8_t>(PointClass::Class2);
+		}
+		if (iin.IsSet(IINBit::CLASS3_EVENTS))
+		{
+			classes |= static_cast<uint8_t>(PointClass::Class3);
+		}
+		if (classes)
+		{
+			m_outstation->eventsRequested |= classes;
+		}
+
+		// Time synchronisation is not done by the plugin
+		bool needTime = iin.IsSet(IINBit::NEED_TIME);
+		if (needTime && !m_outstation->needTime.exchange(needTime))
+		{
+			Logger::getLogger()->warn("Outstation id %d needs time synchronisation",
+						  m_outstation->linkId);
+		}
+		else if (!needTime)
+		{
+			m_outstation->needTime = false;
+		}
+	}
+
+	// Count failed master tasks for the link statistics
+	virtual void OnTaskComplete(const TaskInfo& info) override
+	{
+		if (info.result == TaskCompletion::FAILURE_RESPONSE_TIMEOUT)
+		{
+			m_outstation->linkStatistics->taskTimeouts++;
+		}
+		else if (info.result != TaskCompletion::SUCCESS)
+		{
+			m_outstation->linkStatistics->taskFailures++;
+		}
+	}
+
 	// Report master link change
 	virtual void OnStateChange(opendnp3::LinkStatus value) override
 	{
@@ -189,6 +622,7 @@ public:
 					m_outstation->address.c_str(),
 					m_outstation->port,
 					m_outstation->linkId);
+		m_outstation->linkStatistics->keepAliveFailures++;
 
 		// Close connection to outstation
 		m->Disable();
@@ -201,6 +635,9 @@ public:
 private:
 	std::shared_ptr<IMaster> m;
 	DNP3::OutStationTCP	*m_outstation;
+	// Copy of the outstation class assignments, used by the I/O thread
+	std::vector<DNP3::ClassAssignment>
+				m_assignments;
 };
 
 } // namespace asiodnp3
@@ -0,0 +1,143 @@
+#ifndef _DNP3_NAMES_H
+#define _DNP3_NAMES_H
+/*
+ * Fledge DNP3 asset and datapoint names
+ *
+ * Copyright (c) 2024 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Massimiliano Pinto
+ */
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+class Datapoint;
+
+#define DEFAULT_ASSET_NAME_TEMPLATE		"remote_$linkid$_$type$_$index$"
+#define DEFAULT_DATAPOINT_NAME_TEMPLATE		"$type$$index$"
+
+// DNP3 object types we get data from
+typedef enum
+{
+	ObjectCounter = 0,
+	ObjectBinary,
+	ObjectBinaryOutputStatus,
+	ObjectAnalog,
+	ObjectAnalogOutput,
+	ObjectDoubleBitBinary,
+	ObjectTypes	// Number of object types
+} Dnp3ObjectType;
+
+// Object type name used in asset and datapoint names
+const std::string& objectTypeName(Dnp3ObjectType type);
+
+/**
+ * A name template compiled once into literal text and fields
+ *
+ * Supported fields are $linkid$, $address$, $port$, $type$ and $index$,
+ * any other text is copied as it is.
+ */
+class NameTemplate
+{
+	public:
+		NameTemplate(const std::string& text = "");
+		// Name for given outstation, object type and index
+		std::string	format(uint16_t linkId,
+				       const std::string& address,
+				       unsigned short port,
+				       const std::string& type,
+				       uint16_t index) const;
+		const std::string&
+				getText() const { return m_text; };
+
+	private:
+		typedef enum
+		{
+			FieldText,
+			FieldLinkId,
+			FieldAddress,
+			FieldPort,
+			FieldType,
+			FieldIndex
+		} Field;
+		std::string	m_text;
+		// Compiled template: field and literal text for FieldText
+		std::vector<std::pair<Field, std::string>>
+				m_segments;
+};
+
+// End offsets of the readings of grouped datapoints: a reading
+// has no repeated datapoint name and at most max datapoints (0 = no limit)
+std::vector<size_t>
+	readingGroups(const std::vector<Datapoint *>& points, size_t max);
+
+// Asset and datapoint names of a point
+class PointNames
+{
+	public:
+		std::string	asset;
+		std::string	datapoint;
+};
+
+/**
+ * Cache of the asset and datapoint names of the points of an outstation
+ *
+ * Names are built the first time a point is received and kept
+ * in arrays addressed by object type and point index.
+ */
+class NameCache
+{
+	public:
+		NameCache(const std::string& prefix,
+			  const std::string& label,
+			  uint16_t linkId,
+			  const std::string& address,
+			  unsigned short port,
+			  const NameTemplate& assetTemplate,
+			  const NameTemplate& datapointTemplate);
+
+		// Names of a point
+		const PointNames&
+				get(Dnp3ObjectType type, uint16_t index)
+		{
+			std::vector<std::unique_ptr<PointNames>>& names = m_names[type];
+			if (index < names.size() && names[index])
+			{
+				return *names[index];
+			}
+			return this->add(type, index);
+		};
+		// Asset name of the readings grouping all the points
+		const std::string&
+				getOutstationAsset() const
+		{
+			return m_outstationAsset;
+		};
+		// Asset name of the readings grouping points of an object type
+		const std::string&
+				getTypeAsset(Dnp3ObjectType type) const
+		{
+			return m_typeAssets[type];
+		};
+
+	private:
+		const PointNames&
+				add(Dnp3ObjectType type, uint16_t index);
+
+	private:
+		std::string	m_prefix;
+		uint16_t	m_linkId;
+		std::string	m_address;
+		unsigned short	m_port;
+		NameTemplate	m_assetTemplate;
+		NameTemplate	m_datapointTemplate;
+		std::string	m_outstationAsset;
+		std::string	m_typeAssets[ObjectTypes];
+		std::vector<std::unique_ptr<PointNames>>
+				m_names[ObjectTypes];
+};
+
+#endif
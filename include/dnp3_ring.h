@@ -0,0 +1,157 @@
+#ifndef _DNP3_RING_H
+#define _DNP3_RING_H
+/*
+ * Fledge DNP3 bounded lock-free ring buffer
+ *
+ * Copyright (c) 2024 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Massimiliano Pinto
+ */
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Bounded multi-producer multi-consumer ring buffer
+ *
+ * Each cell carries a sequence number which tells producers
+ * and consumers whether the cell is free or filled: no locks
+ * are taken, push and pop fail instead of blocking when
+ * the ring is full or empty.
+ *
+ * The capacity is rounded up to a power of two.
+ */
+template<class T> class Dnp3Ring
+{
+	public:
+		Dnp3Ring(size_t size)
+		{
+			size_t capacity = 2;
+			while (capacity < size)
+			{
+				capacity <<= 1;
+			}
+			m_mask = capacity - 1;
+			m_cells.reset(new Cell[capacity]);
+			for (size_t i = 0; i < capacity; i++)
+			{
+				m_cells[i].sequence.store(i, std::memory_order_relaxed);
+			}
+			m_enqueuePos.store(0, std::memory_order_relaxed);
+			m_dequeuePos.store(0, std::memory_order_relaxed);
+		};
+
+		/**
+		 * Add an item, filled in place by the given function
+		 *
+		 * @param fill	Function called with the cell item to set
+		 * @return	False if the ring is full
+		 */
+		template<class F> bool	emplace(F fill)
+		{
+			Cell *cell;
+			size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+			for (;;)
+			{
+				cell = &m_cells[pos & m_mask];
+				size_t seq = cell->sequence.load(std::memory_order_acquire);
+				intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+				if (diff == 0)
+				{
+					if (m_enqueuePos.compare_exchange_weak(pos,
+									       pos + 1,
+									       std::memory_order_relaxed))
+					{
+						break;
+					}
+				}
+				else if (diff < 0)
+				{
+					// Full
+					return false;
+				}
+				else
+				{
+					pos = m_enqueuePos.load(std::memory_order_relaxed);
+				}
+			}
+			fill(cell->data);
+			cell->sequence.store(pos + 1, std::memory_order_release);
+			return true;
+		};
+
+		// Add a copy of an item, false if the ring is full
+		bool	push(const T& item)
+		{
+			return emplace([&item](T& data) { data = item; });
+		};
+
+		/**
+		 * Remove the oldest item
+		 *
+		 * @param item	The item removed
+		 * @return	False if the ring is empty
+		 */
+		bool	pop(T& item)
+		{
+			Cell *cell;
+			size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+			for (;;)
+			{
+				cell = &m_cells[pos & m_mask];
+				size_t seq = cell->sequence.load(std::memory_order_acquire);
+				intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+				if (diff == 0)
+				{
+					if (m_dequeuePos.compare_exchange_weak(pos,
+									       pos + 1,
+									       std::memory_order_relaxed))
+					{
+						break;
+					}
+				}
+				else if (diff < 0)
+				{
+					// Empty
+					return false;
+				}
+				else
+				{
+					pos = m_dequeuePos.load(std::memory_order_relaxed);
+				}
+			}
+			item = std::move(cell->data);
+			cell->sequence.store(pos + m_mask + 1, std::memory_order_release);
+			return true;
+		};
+
+		// Number of items in the ring: approximate while in use
+		size_t	size() const
+		{
+			size_t enq = m_enqueuePos.load(std::memory_order_relaxed);
+			size_t deq = m_dequeuePos.load(std::memory_order_relaxed);
+			return enq > deq ? enq - deq : 0;
+		};
+		bool	empty() const { return size() == 0; };
+		size_t	capacity() const { return m_mask + 1; };
+
+	private:
+		struct Cell
+		{
+			std::atomic<size_t>	sequence;
+			T			data;
+		};
+
+		std::unique_ptr<Cell[]>	m_cells;
+		size_t			m_mask;
+		// Producer and consumer positions on separate cache lines
+		char			m_pad0[64];
+		std::atomic<size_t>	m_enqueuePos;
+		char			m_pad1[64 - sizeof(std::atomic<size_t>)];
+		std::atomic<size_t>	m_dequeuePos;
+};
+
+#endif
@@ -0,0 +1,171 @@
+#ifndef _DNP3_STATS_H
+#define _DNP3_STATS_H
+/*
+ * Fledge DNP3 data pipeline statistics
+ *
+ * Copyright (c) 2024 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Massimiliano Pinto
+ */
+#include <atomic>
+#include <vector>
+#include <string>
+#include <map>
+#include <cstdint>
+
+class Datapoint;
+
+/**
+ * Lock-free histogram with power of two buckets:
+ * bucket i counts values from 2^(i-1) up to 2^i - 1, bucket 0 counts 0
+ */
+class Dnp3Histogram
+{
+	public:
+		static const int	Buckets = 32;
+
+		Dnp3Histogram()
+		{
+			for (auto& bucket : m_buckets)
+			{
+				bucket = 0;
+			}
+		};
+
+		void	record(uint64_t value)
+		{
+			m_buckets[bucket(value)].fetch_add(1, std::memory_order_relaxed);
+		};
+
+		// Move the counts to counts array and reset them
+		void	take(uint64_t counts[Buckets])
+		{
+			for (int i = 0; i < Buckets; i++)
+			{
+				counts[i] = m_buckets[i].exchange(0, std::memory_order_relaxed);
+			}
+		};
+
+		// Upper bound of the bucket holding the percentile p (0-100)
+		static uint64_t
+			percentile(const uint64_t counts[Buckets], double p)
+		{
+			uint64_t total = 0;
+			for (int i = 0; i < Buckets; i++)
+			{
+				total += counts[i];
+			}
+			if (total == 0)
+			{
+				return 0;
+			}
+			uint64_t rank = (uint64_t)(total * p / 100.0 + 0.5);
+			uint64_t seen = 0;
+			for (int i = 0; i < Buckets; i++)
+			{
+				seen += counts[i];
+				if (seen >= rank && counts[i])
+				{
+					return i ? (1ULL << i) - 1 : 0;
+				}
+			}
+			return (1ULL << (Buckets - 1)) - 1;
+		};
+
+		static int
+			bucket(uint64_t value)
+		{
+			int i = 0;
+			while (value && i < Buckets - 1)
+			{
+				value >>= 1;
+				i++;
+			}
+			return i;
+		};
+
+	private:
+		std::atomic<uint64_t>	m_buckets[Buckets];
+};
+
+/**
+ * Data pipeline statistics of an outstation
+ *
+ * Counters are updated by the SOE handler of the outstation and
+ * reported, then reset, by the scan thread.
+ */
+class Dnp3Statistics
+{
+	public:
+		Dnp3Statistics() :
+			pointsReceived(0),
+			pointsInvalid(0),
+			pointsFiltered(0),
+			readings(0),
+			readingsDropped(0),
+			responses(0) {};
+
+		// Datapoints of the statistics reading for the
+		// given reporting period in seconds
+		std::vector<Datapoint *>
+			report(double seconds);
+
+		std::atomic<uint64_t>	pointsReceived;
+		// Points discarded by the quality check
+		std::atomic<uint64_t>	pointsInvalid;
+		// Points discarded by deadband or unchanged data checks
+		std::atomic<uint64_t>	pointsFiltered;
+		// Readings queued and discarded with full ingest queue
+		std::atomic<uint64_t>	readings;
+		std::atomic<uint64_t>	readingsDropped;
+		std::atomic<uint64_t>	responses;
+		// Object header callback duration in microseconds
+		Dnp3Histogram		callbackTime;
+		// Event time to ingest in milliseconds
+		Dnp3Histogram		eventLatency;
+};
+
+/**
+ * Last sampled values of the cumulative counters of the DNP3 stack,
+ * to report their changes between two samples
+ */
+class Dnp3CounterSample
+{
+	public:
+		// Add a datapoint with the change of a counter since last sample
+		void	add(std::vector<Datapoint *>& points,
+			    const std::string& name,
+			    uint64_t value);
+
+	private:
+		std::map<std::string, uint64_t>	m_last;
+};
+
+/**
+ * Link statistics of an outstation: application layer counters
+ * updated by the master application and the last sample of the
+ * link and transport layer counters of the master
+ */
+class Dnp3LinkStatistics
+{
+	public:
+		Dnp3LinkStatistics() :
+			taskTimeouts(0),
+			taskFailures(0),
+			keepAliveFailures(0) {};
+
+		// Add the datapoints of the application counters and reset them
+		void	report(std::vector<Datapoint *>& points);
+
+		// Master tasks with no response in the application timeout
+		std::atomic<uint64_t>	taskTimeouts;
+		// Master tasks failed for any other reason
+		std::atomic<uint64_t>	taskFailures;
+		std::atomic<uint64_t>	keepAliveFailures;
+		// Accessed by the scan thread only
+		Dnp3CounterSample	stack;
+};
+
+#endif
@@ -14,6 +14,17 @@
 #include <logger.h>
 #include <mutex>
 #include <vector>
+#include <map>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
+
+#include "dnp3_ring.h"
+#include "dnp3_names.h"
+#include "dnp3_filter.h"
+#include "dnp3_stats.h"
 
 #include <asiodnp3/ConsoleLogger.h>
 #include <asiodnp3/DNP3Manager.h>
@@ -31,13 +42,94 @@
 #define DEFAULT_TCP_PORT      			"20000"   
 #define DEFAULT_OUTSTATION_ID			"10"
 #define DEFAULT_OUTSTATION_SCAN_INTERVAL	"30" // seconds
+#define DEFAULT_EVENT_SCAN_INTERVAL		"0" // seconds, 0 means no event scan
+#define SCAN_CONNECT_SPREAD			10 // seconds
+#define DEFAULT_DATA_MODE			"Polling"
+#define IIN_RECOVERY_INTERVAL			10 // seconds
+#define DEFAULT_RETRY_MIN			"20" // seconds
+#define DEFAULT_RETRY_MAX			"300" // seconds
+#define DEFAULT_RETRY_JITTER			"20" // percent
+#define DEFAULT_BACKOFF_THRESHOLD		"0" // channels, 0 means no threshold
+#define DEFAULT_STATISTICS_INTERVAL		"0" // seconds, 0 means no statistics
+#define DEFAULT_LINK_STATISTICS_INTERVAL	"0" // seconds, 0 means no statistics
 #define DEFAULT_ASSETNAME_PREFIX		"dnp3_"
+#define DEFAULT_READING_MODE			"Per point"
+#define DEFAULT_MAX_READING_DATAPOINTS		"1000"
+#define DEFAULT_INGEST_QUEUE_SIZE		"65536"
+#define INGEST_BATCH_SIZE			256
+#define INGEST_QUEUE_REPORT_INTERVAL		60 // seconds
+#define DATA_DEBUG_MESSAGES_PER_SECOND		100 // per outstation
+#define DEFAULT_WORKER_THREADS			"0" // number of CPU cores
 
 #define ONLINE_FLAG_ALL_OBJECTS			0x01
+
+namespace asiodnp3
+{
+	class DNP3MasterApplication;
+	class DNP3ChannelListener;
+	class DNP3ReconnectStrategy;
+};
+
 // DNP3 class for DNP3 Fledge South plugin
 class DNP3
 {
 	public:
+		// A periodic read of a range or all the objects of a group variation
+		class RangeScan
+		{
+			public:
+				RangeScan()
+				{
+					linkId = 0;
+					group = 0;
+					variation = 0;
+					start = 0;
+					stop = 0;
+					allObjects = false;
+					period = 1;
+				};
+
+				uint16_t	linkId;
+				uint8_t		group;
+				uint8_t		variation;
+				uint16_t	start;
+				uint16_t	stop;
+				bool		allObjects;
+				// Seconds
+				unsigned long	period;
+				// Next scan, unset if not scheduled
+				std::chrono::steady_clock::time_point
+						next;
+		};
+
+		// Event class of a range of points, assigned at master startup
+		class ClassAssignment
+		{
+			public:
+				ClassAssignment()
+				{
+					linkId = 0;
+					group = 0;
+					start = 0;
+					stop = 0;
+					clazz = opendnp3::PointClass::Class1;
+				};
+				bool	operator==(const ClassAssignment& c) const
+				{
+					return linkId == c.linkId &&
+						group == c.group &&
+						start == c.start &&
+						stop == c.stop &&
+						clazz == c.clazz;
+				};
+
+				uint16_t		linkId;
+				uint8_t			group;
+				uint16_t		start;
+				uint16_t		stop;
+				opendnp3::PointClass	clazz;
+		};
+
 		// This class describes the TCP outstation (remote endpoint)
 		class OutStationTCP
 		{
@@ -48,36 +140,169 @@ class DNP3
 					address = DEFAULT_TCP_ADDR;
 					port = (short unsigned int)atoi(DEFAULT_TCP_PORT);
 					linkId = (uint16_t)atoi(DEFAULT_OUTSTATION_ID);
+					disableTLS = true;
+					integrityInterval = 0;
+					eventInterval = 0;
+					unsolicited = false;
+					retryMin = 0;
+					retryMax = 0;
+					connected = false;
+					scanRequested = false;
+					integrityRequested = false;
+					eventsRequested = 0;
+					needTime = false;
+					statistics = std::make_shared<Dnp3Statistics>();
+					linkStatistics = std::make_shared<Dnp3LinkStatistics>();
+				};
+				// Same outstation: same link id and remote endpoint
+				bool	sameOutstation(const OutStationTCP& o) const
+				{
+					return linkId == o.linkId &&
+						port == o.port &&
+						address == o.address;
+				};
+				// Same remote endpoint and TLS settings:
+				// outstations can share the channel
+				bool	sameEndpoint(const OutStationTCP& o) const
+				{
+					return port == o.port &&
+						address == o.address &&
+						retryMin == o.retryMin &&
+						retryMax == o.retryMax &&
+						disableTLS == o.disableTLS &&
+						peerCertificate == o.peerCertificate &&
+						certificate == o.certificate;
 				};
+				// Same outstation and channel settings
+				bool	sameChannel(const OutStationTCP& o) const
+				{
+					return linkId == o.linkId &&
+						sameEndpoint(o);
+				};
+
 				std::string		address;
 				short unsigned int	port;
 				uint16_t		linkId;
 				bool			disableTLS;
 				std::string		TLSCAcertificate;
 				std::string		TLScertificate;
+				// Scan intervals in seconds, 0 for the global setting
+				unsigned long		integrityInterval;
+				unsigned long		eventInterval;
+				// Range scans of the outstation
+				std::vector<RangeScan>	rangeScans;
+				// Connection retry delays in seconds set in the list,
+				// 0 if not set: the global setting is used when
+				// the channel is opened
+				unsigned long		retryMin;
+				unsigned long		retryMax;
+				// Event classes assigned at master startup
+				std::vector<ClassAssignment>
+							classAssignments;
+				// Startup integrity poll and unsolicited events
+				// instead of periodic class scans
+				bool			unsolicited;
+				// TLS certificates in use: path without extension
+				std::string		peerCertificate;
+				std::string		certificate;
+
+				// DNP3 objects of a started outstation:
+				// channel and listener may be shared
+				std::shared_ptr<asiodnp3::IChannel>
+							channel;
+				std::shared_ptr<asiodnp3::DNP3ChannelListener>
+							listener;
+				std::shared_ptr<asiodnp3::IMaster>
+							master;
+				std::shared_ptr<asiodnp3::DNP3MasterApplication>
+							application;
+				// Set by the channel listener
+				std::atomic<bool>	connected;
+				// Integrity scan needed, set when the channel is open
+				std::atomic<bool>	scanRequested;
+				// Data pipeline statistics, kept by reconfiguration
+				std::shared_ptr<Dnp3Statistics>
+							statistics;
+				std::shared_ptr<Dnp3LinkStatistics>
+							linkStatistics;
+				// Polls requested by the outstation IIN bits:
+				// integrity and PointClass bits of event classes
+				std::atomic<bool>	integrityRequested;
+				std::atomic<uint8_t>	eventsRequested;
+				std::atomic<bool>	needTime;
+				std::chrono::steady_clock::time_point
+							lastRecovery;
+				// Next scans, unset if not scheduled
+				std::chrono::steady_clock::time_point
+							nextIntegrity;
+				std::chrono::steady_clock::time_point
+							nextEvents;
 		};
 
+	public:
+		// How points received in a response are grouped into readings
+		typedef enum
+		{
+			ReadingPerPoint,	// One reading per point (asset per point)
+			ReadingPerHeader,	// One reading per object header
+			ReadingPerResponse,	// One reading per object type per response
+			ReadingPerOutstation	// One reading per response
+		} ReadingMode;
+
 	public:
 		DNP3(const std::string& name) : m_serviceName(name)
 		{
 			m_manager = NULL;     // configure() creates the object
+			m_readingMode = ReadingPerPoint;
+			m_arrayDatapoints = false;
+			m_suppressUnchanged = false;
+			this->setNameTemplates(DEFAULT_ASSET_NAME_TEMPLATE,
+					       DEFAULT_DATAPOINT_NAME_TEMPLATE);
+			m_ingestQueueSize =
+				(unsigned long)atol(DEFAULT_INGEST_QUEUE_SIZE);
+			m_ingestThread = NULL;
+			m_workerThreads =
+				(unsigned int)atoi(DEFAULT_WORKER_THREADS);
+			m_ingestRunning = false;
+			m_ingestWaiting = false;
+			m_ingestDropped = 0;
+			m_ingestQueuePeak = 0;
+			m_scanThread = NULL;
+			m_scanRunning = false;
+			m_dataGeneration = 0;
+			m_maxReadingDatapoints =
+				(unsigned long)atol(DEFAULT_MAX_READING_DATAPOINTS);
 			m_enableScan = false; // Scan outstation (Integrity Poll)
 			// Default scan interval in seconds
 			m_outstationScanInterval =
 				(unsigned long)atol(DEFAULT_OUTSTATION_SCAN_INTERVAL);
+			m_eventScanInterval =
+				(unsigned long)atol(DEFAULT_EVENT_SCAN_INTERVAL);
+			m_unsolicited = false;
+			m_statisticsInterval =
+				(unsigned long)atol(DEFAULT_STATISTICS_INTERVAL);
+			m_linkStatisticsInterval =
+				(unsigned long)atol(DEFAULT_LINK_STATISTICS_INTERVAL);
+			this->setRetry((unsigned long)atol(DEFAULT_RETRY_MIN),
+				       (unsigned long)atol(DEFAULT_RETRY_MAX),
+				       (unsigned int)atoi(DEFAULT_RETRY_JITTER),
+				       (unsigned int)atoi(DEFAULT_BACKOFF_THRESHOLD));
 			// Network timeout default
 			m_applicationTimeout = 
-				(unsigned long)DEFAULT_APPLICATION_TIMEOUT;
+				(unsigned long)atol(DEFAULT_APPLICATION_TIMEOUT);
 		};
 		~DNP3()
 		{
+			this->stopScan();
 			if (m_manager)
 			{
 				delete m_manager;
 			}
+			this->stopIngest();
 			auto it = m_outstations.begin();
 			while (it != m_outstations.end())
 			{
+				delete *it;
 				it = m_outstations.erase(it);
 			}
 		};
@@ -87,12 +312,23 @@ class DNP3
 		// Unlock configuration items
 		void	unlockConfig() { m_configMutex.unlock(); };
 
-		// Ingest function
-		void	ingest(std::string assetName,
-				std::vector<Datapoint *>  points)
+		// Ingest function: queue the reading for the ingest thread
+		// The asset name includes the asset name prefix
+		// Return false if the reading is discarded
+		bool	ingest(const std::string& assetName,
+				std::vector<Datapoint *>&  points)
 		{
-			(*m_ingest)(m_data, Reading(m_asset + assetName, points));
-		}
+			return this->ingest(assetName,
+					    points,
+					    std::vector<uint64_t>(),
+					    std::shared_ptr<Dnp3Statistics>());
+		};
+		// Ingest a reading with events: their latency is recorded
+		// in the statistics when the reading is passed to Fledge
+		bool	ingest(const std::string& assetName,
+				std::vector<Datapoint *>&  points,
+				const std::vector<uint64_t>& eventTimes,
+				const std::shared_ptr<Dnp3Statistics>& stats);
 		// Register ingest function
 		void	registerIngest(void *data, void (*cb)(void *, Reading))
 		{
@@ -103,6 +339,35 @@ class DNP3
 		{
 			m_asset = asset;
 		};
+		const std::string&
+			getAssetName() const { return m_asset; };
+		void	setNameTemplates(const std::string& asset,
+					 const std::string& datapoint)
+		{
+			m_assetNameTemplate = NameTemplate(asset);
+			m_datapointNameTemplate = NameTemplate(datapoint);
+		};
+		const NameTemplate&
+			getAssetNameTemplate() const
+		{
+			return m_assetNameTemplate;
+		};
+		const NameTemplate&
+			getDatapointNameTemplate() const
+		{
+			return m_datapointNameTemplate;
+		};
+		void	setDeadbands(const std::vector<Deadband>& deadbands)
+		{
+			m_deadbands = deadbands;
+		};
+		const std::vector<Deadband>&
+			getDeadbands() const { return m_deadbands; };
+		void	setSuppressUnchanged(bool suppress)
+		{
+			m_suppressUnchanged = suppress;
+		};
+		bool	getSuppressUnchanged() const { return m_suppressUnchanged; };
 		void	setMasterLinkId(uint16_t id)
 		{
 			m_masterId = id;
@@ -115,15 +380,14 @@ class DNP3
 		{
 			for (OutStationTCP *o : m_outstations)
 			{
-				if (o->linkId == outstation->linkId &&
-				    o->port == outstation->port &&
-				    o->address == outstation->address)
+				if (o->sameOutstation(*outstation))
 				{
 					Logger::getLogger()->error("Skip outstation entry in the list as an outstation " \
 							"already exists with address %s, port %d and linkId %d",
 							outstation->address.c_str(),
 							outstation->port,
 							outstation->linkId);
+					delete outstation;
 					return;
 				}
 			}
@@ -141,16 +405,14 @@ class DNP3
 		bool	start();
 
 		// Stop master anc close outstation connection
-		void	stop()
-		{
-			if (m_manager)
-			{
-				m_manager->Shutdown();
-				delete m_manager;
-				m_manager = NULL;
-			}
-		};
+		void	stop();
 		bool	configure(ConfigCategory* config);
+		// Apply a new configuration to a running master
+		bool	reconfigure(ConfigCategory* config);
+
+		// Changes each time data settings are changed
+		unsigned long
+			getDataGeneration() const { return m_dataGeneration.load(); };
 		void	enableScan(bool val) { m_enableScan = val; };
 		bool	isScanEnabled() const { return m_enableScan; };
 		unsigned long
@@ -162,6 +424,42 @@ class DNP3
 		{
 			m_outstationScanInterval = val;
 		};
+		// Connection retry delays in seconds, jitter in percent
+		// and number of channels connecting above which failed
+		// connections wait for the maximum delay
+		void	setRetry(unsigned long minDelay,
+				 unsigned long maxDelay,
+				 unsigned int jitter,
+				 unsigned int backoffThreshold)
+		{
+			m_retryMin = minDelay;
+			m_retryMax = std::max(minDelay, maxDelay);
+			m_retryJitter = std::min(jitter, 100U);
+			m_backoffThreshold = backoffThreshold;
+		};
+		// Statistics reading interval in seconds, 0 for none
+		void	setStatisticsInterval(unsigned long val)
+		{
+			m_statisticsInterval = val;
+		};
+		unsigned long
+			getStatisticsInterval() const { return m_statisticsInterval; };
+		// Link statistics reading interval in seconds, 0 for none
+		void	setLinkStatisticsInterval(unsigned long val)
+		{
+			m_linkStatisticsInterval = val;
+		};
+		void	setUnsolicited(bool val) { m_unsolicited = val; };
+		bool	isUnsolicited() const { return m_unsolicited; };
+		unsigned long
+			getEventScanInterval() const
+		{
+			return m_eventScanInterval;
+		};
+		void	setEventScanInterval(unsigned long val)
+		{
+			m_eventScanInterval = val;
+		};
 
 		void	setAppLogLevel(uint32_t level)
 		{
@@ -173,13 +471,121 @@ class DNP3
 			return m_appLogLevel;
 		};
 
+		void	setReadingMode(ReadingMode mode)
+		{
+			m_readingMode = mode;
+		};
+		ReadingMode
+			getReadingMode() const { return m_readingMode; };
+		// Contiguous points as array datapoints
+		void	setArrayDatapoints(bool val) { m_arrayDatapoints = val; };
+		bool	getArrayDatapoints() const { return m_arrayDatapoints; };
+		void	setMaxReadingDatapoints(unsigned long val)
+		{
+			m_maxReadingDatapoints = val;
+		};
+		unsigned long
+			getMaxReadingDatapoints() const
+		{
+			return m_maxReadingDatapoints;
+		};
+		void	setIngestQueueSize(unsigned long val)
+		{
+			m_ingestQueueSize = val;
+		};
+		// DNP3 worker threads, 0 means one per CPU core
+		void	setWorkerThreads(unsigned int val)
+		{
+			m_workerThreads = val;
+		};
+		unsigned int
+			getWorkerThreads() const;
+		// CPU lists to pin worker threads and ingest thread to
+		void	setCpuAffinity(const std::string& workers,
+				       const std::string& ingest)
+		{
+			m_workerCpus = workers;
+			m_ingestCpus = ingest;
+		};
+
+		// Ingest queue metrics
+		size_t	getIngestQueueDepth() const
+		{
+			return m_ingestQueue ? m_ingestQueue->size() : 0;
+		};
+		size_t	getIngestQueuePeak() const
+		{
+			return m_ingestQueuePeak.load();
+		};
+		uint64_t
+			getIngestDropped() const
+		{
+			return m_ingestDropped.load();
+		};
+
+	private:
+		// A reading in the ingest queue: the Reading object is
+		// created when passed to Fledge, so it is not copied
+		class QueuedReading
+		{
+			public:
+				std::string		asset;
+				std::vector<Datapoint *>
+							points;
+				// Event times in milliseconds since the epoch
+				// and the statistics they are recorded in
+				std::vector<uint64_t>	eventTimes;
+				std::shared_ptr<Dnp3Statistics>
+							stats;
+		};
+
+		void	startIngest();
+		void	stopIngest();
+		void	ingestThread();
+
+		// Create channels and masters of outstations in parallel
+		bool	startOutstations(const std::vector<OutStationTCP *>& outstations);
+		// Create channel and master of an outstation
+		bool	startOutstation(OutStationTCP *outstation);
+#ifdef USE_TLS
+		// TLS configuration shared by channels with same certificates
+		std::shared_ptr<asiopal::TLSConfig>
+			getTLSConfig(const OutStationTCP *outstation);
+		void	clearTLSConfigs();
+#endif
+		bool	openChannel(OutStationTCP *outstation);
+		bool	startMaster(OutStationTCP *outstation);
+		// Shutdown master or channel and master of an outstation
+		void	stopMaster(OutStationTCP *outstation);
+		void	stopOutstation(OutStationTCP *outstation);
+
+		// Outstation scans
+		void	startScan();
+		void	stopScan();
+		void	scanThread();
+
 	private:
 		std::string		m_serviceName;
 		std::string		m_asset;
+		NameTemplate		m_assetNameTemplate;
+		NameTemplate		m_datapointNameTemplate;
+		std::vector<Deadband>	m_deadbands;
+		bool			m_suppressUnchanged;
 		uint16_t		m_masterId;
 		asiodnp3::DNP3Manager* 	m_manager;
 		bool			m_enableScan;
 		unsigned long		m_outstationScanInterval;
+		unsigned long		m_eventScanInterval;
+		bool			m_unsolicited;
+		unsigned long		m_statisticsInterval;
+		unsigned long		m_linkStatisticsInterval;
+		unsigned long		m_retryMin;
+		unsigned long		m_retryMax;
+		unsigned int		m_retryJitter;
+		unsigned int		m_backoffThreshold;
+		// Reconnect delays of all the channels
+		std::shared_ptr<asiodnp3::DNP3ReconnectStrategy>
+					m_reconnect;
 		unsigned long		m_applicationTimeout;
 		std::mutex		m_configMutex;;
 		void			(*m_ingest)(void *, Reading);
@@ -191,21 +597,172 @@ class DNP3
 		bool			m_enable_tls;
 		std::string		m_ca_cert; // CA or peer TLS certificate name: only public PEM certificate
 		std::string		m_certs_pair; // Master TLS certificate name: key and public PEM certs
+#ifdef USE_TLS
+		// Checked TLS configurations, NULL if certificates are not usable
+		std::map<std::string, std::shared_ptr<asiopal::TLSConfig>>
+					m_tlsConfigs;
+		std::mutex		m_tlsMutex;
+#endif
+		ReadingMode		m_readingMode;
+		bool			m_arrayDatapoints;
+		unsigned long		m_maxReadingDatapoints; // 0 means no limit
+		// Readings handed off by the DNP3 threads to the ingest thread
+		unsigned long		m_ingestQueueSize;
+		unsigned int		m_workerThreads;
+		std::string		m_workerCpus;	// i.e. "0-3,6", empty for no affinity
+		std::string		m_ingestCpus;
+		// Scan scheduler
+		std::thread		*m_scanThread;
+		bool			m_scanRunning;
+		std::condition_variable	m_scanCV;
+		// Scan slots of all outstations are relative to this
+		std::chrono::steady_clock::time_point
+					m_scanEpoch;
+		std::chrono::steady_clock::time_point
+					m_lastStatistics;
+		std::chrono::steady_clock::time_point
+					m_lastLinkStatistics;
+		std::atomic<unsigned long>
+					m_dataGeneration;
+		std::unique_ptr<Dnp3Ring<QueuedReading>>
+					m_ingestQueue;
+		std::thread		*m_ingestThread;
+		std::atomic<bool>	m_ingestRunning;
+		std::atomic<bool>	m_ingestWaiting;
+		std::mutex		m_ingestMutex;
+		std::condition_variable	m_ingestCV;
+		std::atomic<uint64_t>	m_ingestDropped;
+		std::atomic<size_t>	m_ingestQueuePeak;
 };
 
-// Convert to string for most object types
-template<class T> std::string ValueToString(const T& meas)
+/**
+ * Debug message of the SOE handler data path
+ *
+ * Arguments are evaluated only if the service log level is debug
+ * and the handler debug message budget is not exhausted
+ */
+#define SOE_DEBUG(...) \
+	do \
+	{ \
+		if (this->debugAllowed()) \
+		{ \
+			Logger::getLogger()->debug(__VA_ARGS__); \
+		} \
+	} while (0)
+
+using namespace opendnp3;
+
+/**
+ * Per object type traits of the data path:
+ * object type, quality check, conversion to datapoint value
+ * and to a number for the deadband checks and array datapoints
+ *
+ * The quality check is done on the point flags:
+ * 0x01 means ONLINE for all objects, STATE is also
+ * accepted for Binary and BinaryOutputStatus objects
+ */
+template<class T> struct Dnp3PointTraits;
+
+// Traits of objects with an analog value
+template<class T, Dnp3ObjectType TYPE> struct Dnp3AnalogTraits
 {
-	return std::to_string(meas.value);
-}
+	static const Dnp3ObjectType type = TYPE;
+	static const bool array = true;
+	static bool isValid(uint8_t flags)
+	{
+		return flags == ONLINE_FLAG_ALL_OBJECTS;
+	};
+	static DatapointValue toValue(const T& meas)
+	{
+		return DatapointValue((double)meas.value);
+	};
+	static double toNumber(const T& meas)
+	{
+		return meas.value;
+	};
+	static std::string toString(const T& meas)
+	{
+		return std::to_string(meas.value);
+	};
+};
 
-// Convert to string for DoubleBitBinary
-template<class T> std::string ValueToStringDBB(const T& meas)
+// Traits of objects with a binary value
+template<class T, Dnp3ObjectType TYPE> struct Dnp3BinaryTraits
 {
-	return DoubleBitToString(meas.value);
-}
+	static const Dnp3ObjectType type = TYPE;
+	static const bool array = true;
+	static bool isValid(uint8_t flags)
+	{
+		return flags == ONLINE_FLAG_ALL_OBJECTS ||
+			(flags & static_cast<uint8_t>(BinaryQuality::STATE));
+	};
+	static DatapointValue toValue(const T& meas)
+	{
+		return DatapointValue((long)meas.value);
+	};
+	static double toNumber(const T& meas)
+	{
+		return meas.value ? 1.0 : 0.0;
+	};
+	static std::string toString(const T& meas)
+	{
+		return std::to_string(meas.value);
+	};
+};
 
-using namespace opendnp3;
+template<> struct Dnp3PointTraits<Analog> :
+	public Dnp3AnalogTraits<Analog, ObjectAnalog> {};
+template<> struct Dnp3PointTraits<AnalogOutputStatus> :
+	public Dnp3AnalogTraits<AnalogOutputStatus, ObjectAnalogOutput> {};
+template<> struct Dnp3PointTraits<Binary> :
+	public Dnp3BinaryTraits<Binary, ObjectBinary> {};
+template<> struct Dnp3PointTraits<BinaryOutputStatus> :
+	public Dnp3BinaryTraits<BinaryOutputStatus, ObjectBinaryOutputStatus> {};
+
+template<> struct Dnp3PointTraits<Counter>
+{
+	static const Dnp3ObjectType type = ObjectCounter;
+	static const bool array = true;
+	static bool isValid(uint8_t flags)
+	{
+		return flags == ONLINE_FLAG_ALL_OBJECTS;
+	};
+	static DatapointValue toValue(const Counter& meas)
+	{
+		return DatapointValue((long)meas.value);
+	};
+	static double toNumber(const Counter& meas)
+	{
+		return meas.value;
+	};
+	static std::string toString(const Counter& meas)
+	{
+		return std::to_string(meas.value);
+	};
+};
+
+// DoubleBitBinary value is ingested as string, i.e. DETERMINED_ON
+template<> struct Dnp3PointTraits<DoubleBitBinary>
+{
+	static const Dnp3ObjectType type = ObjectDoubleBitBinary;
+	static const bool array = false;
+	static bool isValid(uint8_t flags)
+	{
+		return flags & ONLINE_FLAG_ALL_OBJECTS;
+	};
+	static DatapointValue toValue(const DoubleBitBinary& meas)
+	{
+		return DatapointValue(std::string(DoubleBitToString(meas.value)));
+	};
+	static double toNumber(const DoubleBitBinary& meas)
+	{
+		return static_cast<int>(meas.value);
+	};
+	static std::string toString(const DoubleBitBinary& meas)
+	{
+		return DoubleBitToString(meas.value);
+	};
+};
 
 namespace asiodnp3
 {
@@ -213,10 +770,44 @@ namespace asiodnp3
 	class dnp3SOEHandler : public opendnp3::ISOEHandler
 	{
 		public:
-			dnp3SOEHandler(DNP3* dnp3, std::string& name)
+			dnp3SOEHandler(DNP3* dnp3,
+				       std::string& name,
+				       const DNP3::OutStationTCP* outstation) :
+				m_names(dnp3->getAssetName(),
+					name,
+					outstation->linkId,
+					outstation->address,
+					outstation->port,
+					dnp3->getAssetNameTemplate(),
+					dnp3->getDatapointNameTemplate())
 			{
 				m_dnp3 = dnp3;
 				m_label = name;
+				m_outstation = outstation;
+				m_generation = dnp3->getDataGeneration();
+				m_readingMode = dnp3->getReadingMode();
+				m_maxDatapoints = dnp3->getMaxReadingDatapoints();
+				m_arrayDatapoints = dnp3->getArrayDatapoints();
+				m_stats = outstation->statistics;
+				m_received = 0;
+				m_invalid = 0;
+				m_filtered = 0;
+				m_lastValues.setDeadbands(dnp3->getDeadbands());
+				m_lastValues.setSuppressUnchanged(dnp3->getSuppressUnchanged());
+				m_debug = false;
+				m_debugBudget = DATA_DEBUG_MESSAGES_PER_SECOND;
+				m_debugSuppressed = 0;
+			};
+			~dnp3SOEHandler()
+			{
+				// Free points of an uncompleted response
+				for (auto& batch : m_responseBatch)
+				{
+					for (Datapoint *dp : batch)
+					{
+						delete dp;
+					}
+				}
 			};
 
 			// Data callbacks
@@ -224,32 +815,32 @@ namespace asiodnp3
 			void Process(const HeaderInfo& info,
 				     const ICollection<Indexed<Counter>>& values) override
 			{
-				return this->dnp3DataCallback(info,values, "Counter");
+				return this->dnp3DataCallback(info,values);
 			};
 			void Process(const HeaderInfo& info,
 				     const ICollection<Indexed<Binary>>& values) override
 			{
-				return this->dnp3DataCallback(info,values, "Binary");
+				return this->dnp3DataCallback(info,values);
 			};
 			void Process(const HeaderInfo& info,
 				     const ICollection<Indexed<BinaryOutputStatus>>& values) override
 			{
-				return this->dnp3DataCallback(info,values, "BinaryOutputStatus");
+				return this->dnp3DataCallback(info,values);
 			};
 			void Process(const HeaderInfo& info,
 				     const ICollection<Indexed<Analog>>& values) override
 			{
-				return this->dnp3DataCallback(info,values, "Analog");
+				return this->dnp3DataCallback(info,values);
 			};
 			void Process(const HeaderInfo& info,
 				     const ICollection<Indexed<AnalogOutputStatus>>& values) override
 			{
-				return this->dnp3DataCallback(info,values, "AnalogOutput");
+				return this->dnp3DataCallback(info,values);
 			};
 			void Process(const HeaderInfo& info,
 				     const ICollection<Indexed<DoubleBitBinary>>& values) //override {};
 			{
-				return this->dnp3DataCallbackDBB(info,values, "DoubleBitBinary");
+				return this->dnp3DataCallback(info,values);
 			};
 
 			// We don't get data from these
@@ -269,38 +860,120 @@ namespace asiodnp3
 				     const ICollection<DNPTime>& values) override {};
 
 		protected:
-			void Start() {};
-			void End() {};
+			// Start of a response: reload data settings if changed
+			void Start()
+			{
+				if (m_dnp3->getDataGeneration() != m_generation)
+				{
+					this->reloadConfig();
+				}
+			};
+			// End of a response: ingest points batched per object type
+			void End()
+			{
+				this->flushResponse();
+				m_stats->responses.fetch_add(1, std::memory_order_relaxed);
+			};
 
 			// Callback for data receiving:
 			// solicited and unsolicited messages
 			template<class T> void
 				dnp3DataCallback(const HeaderInfo& info,
-						 const ICollection<Indexed<T>>& values,
-						 const std::string& objectType);
-			// Callback for data receiving of DoubleBitBinary
-			// solicited and unsolicited messages
-			template<class T> void
-				dnp3DataCallbackDBB(const HeaderInfo& info,
-						 const ICollection<Indexed<T>>& values,
-						 const std::string& objectType);
+						 const ICollection<Indexed<T>>& values);
 
 			// Process a data element from callback
-			// and ingest data into Fledge
-			template<class T> void dataElement(const opendnp3::HeaderInfo& info,
+			// and return the datapoint to ingest, NULL if skipped
+			template<class T> Datapoint* dataElement(const opendnp3::HeaderInfo& info,
 							   const T& value,
-							   uint16_t index,
-							   const std::string& objectName);
-			// Process a data element from callback of DoubleBitBinary
-			// and ingest data into Fledge
-			template<class T> void dataElementDBB(const opendnp3::HeaderInfo& info,
-							   const T& value,
-							   uint16_t index,
-							   const std::string& objectName);
+							   uint16_t index);
+			// Process the data elements of an object header
+			// as datapoints of contiguous points
+			template<class T> void arrayElements(const opendnp3::HeaderInfo& info,
+							     const ICollection<Indexed<T>>& values,
+							     std::vector<Datapoint *>& points,
+							     std::vector<uint64_t>& times);
+			// Return true if the element is to be ingested
+			template<class T> bool acceptElement(const opendnp3::HeaderInfo& info,
+							     const T& value,
+							     uint16_t index);
+
+			// Ingest one datapoint or batch the datapoints of a header,
+			// with the event time of each datapoint, 0 if not an event
+			void	ingestPoint(Datapoint* point,
+					    uint64_t time,
+					    uint16_t index,
+					    Dnp3ObjectType objectType);
+			void	batchPoints(std::vector<Datapoint *>& points,
+					    std::vector<uint64_t>& times,
+					    Dnp3ObjectType objectType);
+			// Ingest batched datapoints of an object type
+			void	ingestBatch(std::vector<Datapoint *>& points,
+					    std::vector<uint64_t>& times,
+					    const std::string& assetName);
+			// Ingest all the batches of current response
+			void	flushResponse();
+			// Ingest a reading, counting it in the statistics
+			virtual void
+				ingestReading(const std::string& assetName,
+					      std::vector<Datapoint *>& points,
+					      const std::vector<uint64_t>& eventTimes);
+			// Add object header counts and duration to the statistics
+			void	updateStatistics(std::chrono::steady_clock::time_point start);
+
+			// Reload data settings after a reconfiguration
+			void	reloadConfig();
+
+			// Check once per object header if data debug is enabled
+			void	checkDebug();
+			// Return true if a data debug message can be logged
+			bool	debugAllowed()
+			{
+				if (!m_debug)
+				{
+					return false;
+				}
+				if (m_debugBudget > 0)
+				{
+					m_debugBudget--;
+					return true;
+				}
+				m_debugSuppressed++;
+				return false;
+			};
 		private:
 			// assetName prefix
 			std::string	m_label;
 			DNP3*		m_dnp3;
+			const DNP3::OutStationTCP*
+					m_outstation;
+			// Data settings generation in use
+			unsigned long	m_generation;
+			DNP3::ReadingMode
+					m_readingMode;
+			unsigned long	m_maxDatapoints;
+			bool		m_arrayDatapoints;
+			// Data debug messages rate limit
+			bool		m_debug;
+			unsigned int	m_debugBudget;
+			unsigned long	m_debugSuppressed;
+			std::chrono::steady_clock::time_point
+					m_debugPeriod;
+			// Asset and datapoint names of outstation points
+			NameCache	m_names;
+			// Last values sent, for deadband and unchanged data checks
+			LastValueStore	m_lastValues;
+			// Pipeline statistics and counts of current object header
+			std::shared_ptr<Dnp3Statistics>
+					m_stats;
+			uint64_t	m_received;
+			uint64_t	m_invalid;
+			uint64_t	m_filtered;
+			// Datapoints per object type, batched until End(),
+			// and their event times
+			std::vector<Datapoint *>
+					m_responseBatch[ObjectTypes];
+			std::vector<uint64_t>
+					m_responseTimes[ObjectTypes];
 	};
 
 } // end namespace asiodnp3
@@ -0,0 +1,261 @@
+/*
+ * Fledge DNP3 asset and datapoint names.
+ *
+ * Copyright (c) 2024 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Massimiliano Pinto
+ */
+#include <string>
+#include <unordered_set>
+#include <logger.h>
+#include <datapoint.h>
+
+#include "dnp3_names.h"
+
+using namespace std;
+
+/**
+ * Return the name of an object type
+ *
+ * @param    type	The object type
+ * @return		The object type name
+ */
+const string& objectTypeName(Dnp3ObjectType type)
+{
+	static const string names[ObjectTypes + 1] = {
+		"Counter",
+		"Binary",
+		"BinaryOutputStatus",
+		"Analog",
+		"AnalogOutput",
+		"DoubleBitBinary",
+		""
+	};
+	return names[type < ObjectTypes ? type : ObjectTypes];
+}
+
+/**
+ * Compile a name template
+ *
+ * @param    text	The template text
+ */
+NameTemplate::NameTemplate(const string& text) : m_text(text)
+{
+	size_t pos = 0;
+	string literal;
+	while (pos < text.length())
+	{
+		size_t start = text.find('$', pos);
+		size_t end = start == string::npos ? string::npos : text.find('$', start + 1);
+		if (end == string::npos)
+		{
+			literal += text.substr(pos);
+			break;
+		}
+
+		literal += text.substr(pos, start - pos);
+
+		string name = text.substr(start + 1, end - start - 1);
+		Field field = FieldText;
+		if (name == "linkid")
+			field = FieldLinkId;
+		else if (name == "address")
+			field = FieldAddress;
+		else if (name == "port")
+			field = FieldPort;
+		else if (name == "type")
+			field = FieldType;
+		else if (name == "index")
+			field = FieldIndex;
+
+		if (field == FieldText)
+		{
+			// Not a field: keep the first '$' as text
+			Logger::getLogger()->warn("Unknown field '$%s$' in name template '%s'",
+						  name.c_str(),
+						  text.c_str());
+			literal += '$';
+			pos = start + 1;
+			continue;
+		}
+
+		if (!literal.empty())
+		{
+			m_segments.push_back(make_pair(FieldText, literal));
+			literal.clear();
+		}
+		m_segments.push_back(make_pair(field, string()));
+		pos = end + 1;
+	}
+
+	if (!literal.empty())
+	{
+		m_segments.push_back(make_pair(FieldText, literal));
+	}
+}
+
+/**
+ * Build a name from the compiled template
+ *
+ * @param    linkId	The outstation link id
+ * @param    address	The outstation address
+ * @param    port	The outstation port
+ * @param    type	The object type name
+ * @param    index	The point index
+ * @return		The name
+ */
+string NameTemplate::format(uint16_t linkId,
+			    const string& address,
+			    unsigned short port,
+			    const string& type,
+			    uint16_t index) const
+{
+	string name;
+	name.reserve(m_text.length() + type.length() + address.length());
+	for (auto& segment : m_segments)
+	{
+		switch (segment.first)
+		{
+			case FieldText:
+				name += segment.second;
+				break;
+			case FieldLinkId:
+				name += to_string(linkId);
+				break;
+			case FieldAddress:
+				name += address;
+				break;
+			case FieldPort:
+				name += to_string(port);
+				break;
+			case FieldType:
+				name += type;
+				break;
+			case FieldIndex:
+				name += to_string(index);
+				break;
+		}
+	}
+	return name;
+}
+
+/**
+ * Create the name cache of an outstation
+ *
+ * @param    prefix		The asset name prefix
+ * @param    label		The outstation label, i.e. remote_20
+ * @param    linkId		The outstation link id
+ * @param    address		The outstation address
+ * @param    port		The outstation port
+ * @param    assetTemplate	Asset name template of single point readings
+ * @param    datapointTemplate	Datapoint name template
+ */
+NameCache::NameCache(const string& prefix,
+		     const string& label,
+		     uint16_t linkId,
+		     const string& address,
+		     unsigned short port,
+		     const NameTemplate& assetTemplate,
+		     const NameTemplate& datapointTemplate) :
+			m_prefix(prefix),
+			m_linkId(linkId),
+			m_address(address),
+			m_port(port),
+			m_assetTemplate(assetTemplate),
+			m_datapointTemplate(datapointTemplate)
+{
+	// Example: dnp3_remote_20
+	m_outstationAsset = prefix + label;
+	for (int type = 0; type < ObjectTypes; type++)
+	{
+		// Example: dnp3_remote_20_Binary
+		m_typeAssets[type] = prefix + label + "_" +
+				     objectTypeName((Dnp3ObjectType)type);
+	}
+}
+
+/**
+ * Build and cache the names of a point
+ *
+ * @param    type	The object type
+ * @param    index	The point index
+ * @return		The point names
+ */
+const PointNames& NameCache::add(Dnp3ObjectType type, uint16_t index)
+{
+	vector<unique_ptr<PointNames>>& names = m_names[type];
+	if (index >= names.size())
+	{
+		names.resize(index + 1);
+	}
+
+	const string& typeName = objectTypeName(type);
+	PointNames *point = new PointNames();
+	// Example: dnp3_remote_20_Binary_0
+	point->asset = m_prefix + m_assetTemplate.format(m_linkId,
+							 m_address,
+							 m_port,
+							 typeName,
+							 index);
+	// Example: Binary0
+	point->datapoint = m_datapointTemplate.format(m_linkId,
+						      m_address,
+						      m_port,
+						      typeName,
+						      index);
+	names[index].reset(point);
+
+	return *point;
+}
+
+/**
+ * Split grouped datapoints into readings, keeping their order.
+ *
+ * A new reading is started when a datapoint name is already in the
+ * current one, i.e. two events of the same point or an event and
+ * the static value of a point in the same response, or when the
+ * maximum number of datapoints is reached.
+ *
+ * @param    points	The datapoints
+ * @param    max	Maximum datapoints per reading, 0 for no limit
+ * @return		End offset in points of each reading
+ */
+vector<size_t> readingGroups(const vector<Datapoint *>& points, size_t max)
+{
+	// Names of the current reading, not copied
+	struct NameHash
+	{
+		size_t operator()(const string *name) const
+		{
+			return hash<string>()(*name);
+		}
+	};
+	struct NameEqual
+	{
+		bool operator()(const string *a, const string *b) const
+		{
+			return *a == *b;
+		}
+	};
+	unordered_set<const string *, NameHash, NameEqual> names;
+	names.reserve(max && max < points.size() ? max : points.size());
+
+	vector<size_t> ends;
+	for (size_t i = 0; i < points.size(); i++)
+	{
+		const string& name = points[i]->getName();
+		if ((max && names.size() == max) || !names.insert(&name).second)
+		{
+			ends.push_back(i);
+			names.clear();
+			names.insert(&name);
+		}
+	}
+	if (!points.empty())
+	{
+		ends.push_back(points.size());
+	}
+	return ends;
+}
@@ -91,7 +91,7 @@ static const char *default_config = QUOTE({
 		"order" : "6"
 		},
 	"outstation_scan_interval" : {
-		"description" : "Outstation scan interval in seconds",
+		"description" : "Outstation integrity poll (Class 0/1/2/3) interval in seconds",
 		"type" : "integer",
 		"default" : DEFAULT_OUTSTATION_SCAN_INTERVAL,
 		"displayName" : "Scan interval",
@@ -136,6 +136,45 @@ static const char *default_config = QUOTE({
 					"default" : "20000",
 					"maximum" : "65000",
 					"minimum" : "1"
+				},
+				"dataMode" : {
+					"description" : "How data is received from the outstation",
+					"displayName" : "Data mode",
+					"type" : "enumeration",
+					"default" : "Use local default",
+					"options" : [
+						"Use local default",
+						"Polling",
+						"Unsolicited"
+					]
+				},
+				"retryMin" : {
+					"description" : "Minimum connection retry delay in seconds, 0 to use the global setting",
+					"displayName" : "Minimum retry delay",
+					"type" : "integer",
+					"default" : "0",
+					"minimum" : "0"
+				},
+				"retryMax" : {
+					"description" : "Maximum connection retry delay in seconds, 0 to use the global setting",
+					"displayName" : "Maximum retry delay",
+					"type" : "integer",
+					"default" : "0",
+					"minimum" : "0"
+				},
+				"integrityInterval" : {
+					"description" : "Integrity poll (Class 0/1/2/3) interval in seconds, 0 to use the global scan interval",
+					"displayName" : "Integrity poll interval",
+					"type" : "integer",
+					"default" : "0",
+					"minimum" : "0"
+				},
+				"eventInterval" : {
+					"description" : "Event poll (Class 1/2/3) interval in seconds, 0 to use the global event scan interval",
+					"displayName" : "Event poll interval",
+					"type" : "integer",
+					"default" : "0",
+					"minimum" : "0"
 				}
 #ifdef USE_TLS
 				,
@@ -177,6 +216,335 @@ static const char *default_config = QUOTE({
 			"description": "DNP3 communication debug objects",
 			"displayName": "DNP3 debug objects",
 			"order" : "10"
+		},
+		"readingMode": {
+			"description" : "How the received DNP3 points are grouped into readings: one reading per point, one reading per object header, one reading per object type for the whole outstation response or one reading for the whole outstation response",
+			"type": "enumeration",
+			"default": DEFAULT_READING_MODE,
+			"options": [
+				"Per point",
+				"Per object header",
+				"Per response",
+				"Per outstation"
+			],
+			"displayName": "Readings",
+			"order" : "14"
+		},
+		"readingMaxDatapoints": {
+			"description" : "Maximum number of datapoints in a reading when points are grouped, 0 means no limit",
+			"type" : "integer",
+			"default" : DEFAULT_MAX_READING_DATAPOINTS,
+			"displayName" : "Maximum datapoints per reading",
+			"order" : "15",
+			"minimum" : "0",
+			"validity" : "readingMode != \"Per point\""
+		},
+		"arrayDatapoints": {
+			"description" : "Ingest points with contiguous indexes in an object header as one datapoint with an array of values, named after the first and last index, i.e. Analog10_19. Double bit binary points are not grouped",
+			"type" : "boolean",
+			"default" : "false",
+			"displayName" : "Array datapoints",
+			"order" : "32",
+			"validity" : "readingMode != \"Per point\""
+		},
+		"assetNameTemplate": {
+			"description" : "Asset name of single point readings, after the asset name prefix. Fields $linkid$, $address$, $port$, $type$ and $index$ are replaced by outstation and point values",
+			"type" : "string",
+			"default" : DEFAULT_ASSET_NAME_TEMPLATE,
+			"displayName" : "Asset name template",
+			"order" : "16",
+			"validity" : "readingMode == \"Per point\""
+		},
+		"datapointNameTemplate": {
+			"description" : "Datapoint name of points. Fields $linkid$, $address$, $port$, $type$ and $index$ are replaced by outstation and point values",
+			"type" : "string",
+			"default" : DEFAULT_DATAPOINT_NAME_TEMPLATE,
+			"displayName" : "Datapoint name template",
+			"order" : "17"
+		},
+		"ingestQueueSize": {
+			"description" : "Maximum number of readings waiting to be ingested: readings received when the queue is full are discarded",
+			"type" : "integer",
+			"default" : DEFAULT_INGEST_QUEUE_SIZE,
+			"displayName" : "Ingest queue size",
+			"order" : "18",
+			"minimum" : "1",
+			"group" : "Advanced"
+		},
+		"statisticsInterval": {
+			"description" : "Interval in seconds of the data pipeline statistics reading of each outstation, asset remote_<linkid>_<address>_<port>_statistics after the asset name prefix, 0 for no statistics",
+			"type" : "integer",
+			"default" : DEFAULT_STATISTICS_INTERVAL,
+			"displayName" : "Statistics interval",
+			"order" : "33",
+			"minimum" : "0",
+			"group" : "Advanced"
+		},
+		"linkStatisticsInterval": {
+			"description" : "Interval in seconds of the channel and link statistics readings, assets remote_<linkids>_<address>_<port>_channel and remote_<linkid>_<address>_<port>_link after the asset name prefix, 0 for no statistics",
+			"type" : "integer",
+			"default" : DEFAULT_LINK_STATISTICS_INTERVAL,
+			"displayName" : "Link statistics interval",
+			"order" : "34",
+			"minimum" : "0",
+			"group" : "Advanced"
+		},
+		"retryMin": {
+			"description" : "Delay in seconds before retrying a failed connection to an outstation, doubled at each failure up to the maximum retry delay",
+			"type" : "integer",
+			"default" : DEFAULT_RETRY_MIN,
+			"displayName" : "Minimum retry delay",
+			"order" : "28",
+			"minimum" : "1",
+			"group" : "Advanced"
+		},
+		"retryMax": {
+			"description" : "Maximum delay in seconds before retrying a failed connection to an outstation",
+			"type" : "integer",
+			"default" : DEFAULT_RETRY_MAX,
+			"displayName" : "Maximum retry delay",
+			"order" : "29",
+			"minimum" : "1",
+			"group" : "Advanced"
+		},
+		"retryJitter": {
+			"description" : "Random reduction of the retry delays in percent, so that outstations do not reconnect all at the same time",
+			"type" : "integer",
+			"default" : DEFAULT_RETRY_JITTER,
+			"displayName" : "Retry delay jitter",
+			"order" : "30",
+			"minimum" : "0",
+			"maximum" : "100",
+			"group" : "Advanced"
+		},
+		"backoffThreshold": {
+			"description" : "Number of outstation connections being attempted above which failed connections wait for the maximum retry delay before the next attempt, 0 for no threshold. Connection attempts are not limited by this threshold",
+			"type" : "integer",
+			"default" : DEFAULT_BACKOFF_THRESHOLD,
+			"displayName" : "Connection backoff threshold",
+			"order" : "31",
+			"minimum" : "0",
+			"group" : "Advanced"
+		},
+		"workerThreads": {
+			"description" : "Number of threads handling the DNP3 communication with all the outstations, 0 means one thread per CPU core",
+			"type" : "integer",
+			"default" : DEFAULT_WORKER_THREADS,
+			"displayName" : "Worker threads",
+			"order" : "19",
+			"minimum" : "0",
+			"group" : "Advanced"
+		},
+		"workerCpuAffinity": {
+			"description" : "CPUs the DNP3 worker threads run on, i.e. 0-3 or 0,2. Leave empty to run on any CPU",
+			"type" : "string",
+			"default" : "",
+			"displayName" : "Worker threads CPUs",
+			"order" : "20",
+			"group" : "Advanced"
+		},
+		"ingestCpuAffinity": {
+			"description" : "CPUs the ingest thread runs on, i.e. 4 or 4-5. Leave empty to run on any CPU",
+			"type" : "string",
+			"default" : "",
+			"displayName" : "Ingest thread CPUs",
+			"order" : "21",
+			"group" : "Advanced"
+		},
+		"deadbands": {
+			"description": "Deadbands of analog and counter points: a value is ingested only if it differs from the last value ingested by more than the absolute deadband and more than the percentage deadband of the last value",
+			"type": "list",
+			"items" : "object",
+			"default": "[]",
+			"order" : "22",
+			"displayName" : "Deadbands",
+			"properties" : {
+					"type" : {
+						"description" : "The object type",
+						"displayName" : "Object type",
+						"type" : "enumeration",
+						"default" : "Analog",
+						"options" : [
+							"Analog",
+							"AnalogOutput",
+							"Counter"
+						]
+					},
+					"start" : {
+						"description" : "First point index the deadband applies to",
+						"displayName" : "First index",
+						"type" : "integer",
+						"default" : "0",
+						"minimum" : "0",
+						"maximum" : "65535"
+					},
+					"stop" : {
+						"description" : "Last point index the deadband applies to",
+						"displayName" : "Last index",
+						"type" : "integer",
+						"default" : "65535",
+						"minimum" : "0",
+						"maximum" : "65535"
+					},
+					"absolute" : {
+						"description" : "Absolute deadband, 0 for none",
+						"displayName" : "Absolute deadband",
+						"type" : "float",
+						"default" : "0",
+						"minimum" : "0"
+					},
+					"percent" : {
+						"description" : "Deadband in percentage of the last value ingested, 0 for none",
+						"displayName" : "Percentage deadband",
+						"type" : "float",
+						"default" : "0",
+						"minimum" : "0"
+					}
+				}
+		},
+		"suppressUnchanged": {
+			"description" : "Ingest static data received by scans only if value or flags differ from the last data ingested for the point. Events are always ingested",
+			"type" : "boolean",
+			"default" : "false",
+			"displayName" : "Ingest changed static data only",
+			"order" : "23"
+		},
+		"event_scan_interval" : {
+			"description" : "Outstation event poll (Class 1/2/3) interval in seconds, 0 for no event poll",
+			"type" : "integer",
+			"default" : DEFAULT_EVENT_SCAN_INTERVAL,
+			"displayName" : "Event scan interval",
+			"order" : "24",
+			"minimum" : "0",
+			"validity" : "outstation_scan_enable == \"true\""
+		},
+		"dataMode": {
+			"description" : "How data is received from the outstations: periodic scans, or one integrity poll at startup followed by unsolicited events only",
+			"type" : "enumeration",
+			"default" : DEFAULT_DATA_MODE,
+			"options" : [
+				"Polling",
+				"Unsolicited"
+			],
+			"displayName" : "Data mode",
+			"order" : "26"
+		},
+		"classAssignments": {
+			"description": "Event classes assigned to ranges of points of the outstations when the master starts: only the points assigned to a Class 1, 2 or 3 generate events",
+			"type": "list",
+			"items" : "object",
+			"default": "[]",
+			"order" : "27",
+			"displayName" : "Event class assignments",
+			"properties" : {
+					"linkid" : {
+						"description" : "The link ID of the outstation",
+						"displayName" : "Link ID",
+						"type" : "integer",
+						"maximum" : "65519",
+						"minimum" : "1",
+						"default" : "10"
+					},
+					"group" : {
+						"description" : "The static object group: 1 binary inputs, 3 double bit binary inputs, 10 binary outputs, 20 counters, 30 analog inputs, 40 analog outputs",
+						"displayName" : "Group",
+						"type" : "integer",
+						"default" : "30",
+						"minimum" : "1",
+						"maximum" : "255"
+					},
+					"start" : {
+						"description" : "First point index",
+						"displayName" : "First index",
+						"type" : "integer",
+						"default" : "0",
+						"minimum" : "0",
+						"maximum" : "65535"
+					},
+					"stop" : {
+						"description" : "Last point index",
+						"displayName" : "Last index",
+						"type" : "integer",
+						"default" : "0",
+						"minimum" : "0",
+						"maximum" : "65535"
+					},
+					"class" : {
+						"description" : "The event class of the points, Class 0 for no events",
+						"displayName" : "Class",
+						"type" : "enumeration",
+						"default" : "Class 1",
+						"options" : [
+							"Class 0",
+							"Class 1",
+							"Class 2",
+							"Class 3"
+						]
+					}
+				}
+		},
+		"rangeScans": {
+			"description": "Periodic reads of a range of points of an object group and variation, for points needed more often than the integrity poll",
+			"type": "list",
+			"items" : "object",
+			"default": "[]",
+			"order" : "25",
+			"displayName" : "Range scans",
+			"properties" : {
+					"linkid" : {
+						"description" : "The link ID of the outstation to scan",
+						"displayName" : "Link ID",
+						"type" : "integer",
+						"maximum" : "65519",
+						"minimum" : "1",
+						"default" : "10"
+					},
+					"group" : {
+						"description" : "The object group, i.e. 30 for analog inputs",
+						"displayName" : "Group",
+						"type" : "integer",
+						"default" : "30",
+						"minimum" : "1",
+						"maximum" : "255"
+					},
+					"variation" : {
+						"description" : "The object variation, 0 for the default variation",
+						"displayName" : "Variation",
+						"type" : "integer",
+						"default" : "0",
+						"minimum" : "0",
+						"maximum" : "255"
+					},
+					"start" : {
+						"description" : "First point index to read",
+						"displayName" : "First index",
+						"type" : "integer",
+						"default" : "0",
+						"minimum" : "0",
+						"maximum" : "65535"
+					},
+					"stop" : {
+						"description" : "Last point index to read",
+						"displayName" : "Last index",
+						"type" : "integer",
+						"default" : "0",
+						"minimum" : "0",
+						"maximum" : "65535"
+					},
+					"allObjects" : {
+						"description" : "Read all the points of the group instead of the index range",
+						"displayName" : "All points",
+						"type" : "boolean",
+						"default" : "false"
+					},
+					"period" : {
+						"description" : "Scan period in seconds",
+						"displayName" : "Period",
+						"type" : "integer",
+						"default" : "1",
+						"minimum" : "1"
+					}
+				}
 		}
 #ifdef USE_TLS
 		,
@@ -317,12 +685,12 @@ void plugin_reconfigure(PLUGIN_HANDLE *handle, string& newConfig)
 
 	if (dnp3)
 	{
-		// Shutdown DNP3 master and close outstation connection
-		dnp3->stop();
-		// Apply new configuration
-		dnp3->configure(&config);
-		// Start master and connect to outstation
-		dnp3->start();
+		// Apply new configuration: only the changed outstation
+		// connections are closed and opened again
+		if (!dnp3->reconfigure(&config))
+		{
+			Logger::getLogger()->error("DNP3 south plugin reconfiguration failed");
+		}
 	}
 }
 
@@ -0,0 +1,92 @@
+/*
+ * Fledge DNP3 data pipeline statistics.
+ *
+ * Copyright (c) 2024 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Massimiliano Pinto
+ */
+#include <reading.h>
+
+#include "dnp3_stats.h"
+
+using namespace std;
+
+/**
+ * Return the statistics of the reporting period as datapoints:
+ * counters and histograms are reset
+ *
+ * @param    seconds	The reporting period in seconds
+ * @return		The datapoints of the statistics reading
+ */
+vector<Datapoint *> Dnp3Statistics::report(double seconds)
+{
+	vector<Datapoint *> points;
+
+	auto add = [&points](const char *name, long value)
+	{
+		DatapointValue dVal(value);
+		points.push_back(new Datapoint(name, dVal));
+	};
+
+	uint64_t received = pointsReceived.exchange(0);
+	add("pointsReceived", received);
+	add("pointsInvalid", pointsInvalid.exchange(0));
+	add("pointsFiltered", pointsFiltered.exchange(0));
+	add("readings", readings.exchange(0));
+	add("readingsDropped", readingsDropped.exchange(0));
+	add("responses", responses.exchange(0));
+
+	DatapointValue rate(seconds > 0 ? received / seconds : 0.0);
+	points.push_back(new Datapoint("pointsPerSecond", rate));
+
+	uint64_t counts[Dnp3Histogram::Buckets];
+	callbackTime.take(counts);
+	add("callbackP50us", Dnp3Histogram::percentile(counts, 50));
+	add("callbackP99us", Dnp3Histogram::percentile(counts, 99));
+
+	eventLatency.take(counts);
+	add("eventLatencyP50ms", Dnp3Histogram::percentile(counts, 50));
+	add("eventLatencyP99ms", Dnp3Histogram::percentile(counts, 99));
+
+	return points;
+}
+
+/**
+ * Add a datapoint with the change of a cumulative counter since
+ * the last sample: the first sample reports the counter value.
+ * A counter lower than the last sample has been reset.
+ *
+ * @param    points	The datapoints to add to
+ * @param    name	The counter name
+ * @param    value	The counter value
+ */
+void Dnp3CounterSample::add(vector<Datapoint *>& points,
+			    const string& name,
+			    uint64_t value)
+{
+	uint64_t& last = m_last[name];
+	DatapointValue dVal((long)(value >= last ? value - last : value));
+	last = value;
+	points.push_back(new Datapoint(name, dVal));
+}
+
+/**
+ * Add the datapoints of the application layer counters
+ * since the last report, and reset them
+ *
+ * @param    points	The datapoints to add to
+ */
+void Dnp3LinkStatistics::report(vector<Datapoint *>& points)
+{
+	auto add = [&points](const char *name, long value)
+	{
+		DatapointValue dVal(value);
+		points.push_back(new Datapoint(name, dVal));
+	};
+
+	add("taskTimeouts", taskTimeouts.exchange(0));
+	add("taskFailures", taskFailures.exchange(0));
+	add("keepAliveFailures", keepAliveFailures.exchange(0));
+}
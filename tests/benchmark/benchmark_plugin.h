@@ -0,0 +1,188 @@
+#ifndef _BENCHMARK_PLUGIN_H
+#define _BENCHMARK_PLUGIN_H
+/*
+ * Fledge DNP3 south plugin benchmarks: plugin configuration
+ * and counting ingest callback
+ *
+ * Copyright (c) 2024 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Massimiliano Pinto
+ */
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+
+#include <plugin_api.h>
+#include <config_category.h>
+#include <reading.h>
+#include <rapidjson/document.h>
+#include <rapidjson/writer.h>
+#include <rapidjson/stringbuffer.h>
+
+#include "outstation_simulator.h"
+
+typedef void (*INGEST_CB)(void *, Reading);
+
+extern "C" {
+	PLUGIN_INFORMATION *plugin_info();
+	PLUGIN_HANDLE plugin_init(ConfigCategory *config);
+	void plugin_start(PLUGIN_HANDLE *handle);
+	void plugin_register_ingest(PLUGIN_HANDLE handle, INGEST_CB cb, void *data);
+	void plugin_reconfigure(PLUGIN_HANDLE *handle, std::string& newConfig);
+	void plugin_shutdown(PLUGIN_HANDLE handle);
+};
+
+/**
+ * Return the plugin configuration category JSON: the value of each
+ * item is its default, unless given in values
+ *
+ * @param values	Item values to set
+ * @return		The configuration category JSON
+ */
+static inline std::string
+	benchmarkConfig(const std::map<std::string, std::string>& values)
+{
+	rapidjson::Document doc;
+	doc.Parse(plugin_info()->config);
+	for (auto& item : doc.GetObject())
+	{
+		std::string value;
+		auto it = values.find(item.name.GetString());
+		if (it != values.end())
+		{
+			value = it->second;
+		}
+		else if (item.value.HasMember("default"))
+		{
+			value = item.value["default"].GetString();
+		}
+		rapidjson::Value v(value.c_str(), doc.GetAllocator());
+		item.value.AddMember("value", v, doc.GetAllocator());
+	}
+
+	rapidjson::StringBuffer buffer;
+	rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+	doc.Accept(writer);
+	return buffer.GetString();
+}
+
+/**
+ * Outstations list item for loopback outstations on
+ * consecutive ports, with consecutive link ids
+ *
+ * @param count		Number of outstations
+ * @param port		Port of the first outstation
+ * @param linkId	Link id of the first outstation
+ * @return		The outstations list JSON
+ */
+static inline std::string
+	benchmarkOutstations(unsigned int count, uint16_t port, uint16_t linkId)
+{
+	std::string list = "[";
+	for (unsigned int i = 0; i < count; i++)
+	{
+		if (i)
+		{
+			list += ",";
+		}
+		list += "{\"linkid\":\"" + std::to_string(linkId + i) +
+			"\",\"address\":\"127.0.0.1\",\"port\":\"" +
+			std::to_string(port + i) + "\"}";
+	}
+	return list + "]";
+}
+
+/**
+ * Ingest callback counting readings and datapoints
+ *
+ * Float datapoints are simulator events holding their generation
+ * time in microseconds since simulatorEpochUs(): the event to ingest
+ * latency of the ones generated after the start time is recorded.
+ */
+class IngestCounter
+{
+	public:
+		IngestCounter() : readings(0), points(0)
+		{
+			this->reset();
+		};
+
+		static void	ingest(void *data, Reading reading)
+		{
+			((IngestCounter *)data)->count(reading);
+		};
+
+		// Reset the counters and the latencies
+		void	reset()
+		{
+			std::lock_guard<std::mutex> guard(m_mutex);
+			readings = 0;
+			points = 0;
+			m_latencies.clear();
+			m_startUs = nowUs();
+		};
+
+		// Latency percentile p (0-100) in microseconds
+		uint64_t
+			latency(double p)
+		{
+			std::lock_guard<std::mutex> guard(m_mutex);
+			if (m_latencies.empty())
+			{
+				return 0;
+			}
+			size_t n = std::min(m_latencies.size() - 1,
+					    (size_t)(m_latencies.size() * p / 100.0));
+			std::nth_element(m_latencies.begin(),
+					 m_latencies.begin() + n,
+					 m_latencies.end());
+			return m_latencies[n];
+		};
+
+		static uint64_t
+			nowUs()
+		{
+			return std::chrono::duration_cast<std::chrono::microseconds>(
+				std::chrono::system_clock::now().time_since_epoch()).count();
+		};
+
+		std::atomic<uint64_t>	readings;
+		std::atomic<uint64_t>	points;
+
+	private:
+		void	count(Reading& reading)
+		{
+			std::vector<Datapoint *> values = reading.getReadingData();
+			uint64_t now = nowUs();
+
+			std::lock_guard<std::mutex> guard(m_mutex);
+			readings++;
+			points += values.size();
+			for (Datapoint *dp : values)
+			{
+				DatapointValue& value = dp->getData();
+				if (value.getType() != DatapointValue::T_FLOAT)
+				{
+					continue;
+				}
+				uint64_t sent = simulatorEpochUs() + (uint64_t)value.toDouble();
+				if (sent >= m_startUs && sent <= now)
+				{
+					m_latencies.push_back(now - sent);
+				}
+			}
+		};
+
+	private:
+		std::mutex		m_mutex;
+		uint64_t		m_startUs;
+		std::vector<uint64_t>	m_latencies;
+};
+
+#endif
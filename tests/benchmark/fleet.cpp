@@ -0,0 +1,320 @@
+/*
+ * Fledge DNP3 south plugin fleet scale benchmark
+ *
+ * N loopback outstations listen on consecutive ports and the
+ * plugin connects to all of them, as the south service starts it.
+ * Reported figures:
+ *
+ *  - time from plugin start to all the outstations connected
+ *    and to integrity data received from all of them
+ *  - memory and threads added per outstation
+ *  - duration of reconfigurations changing the scan settings of
+ *    all the outstations, removing half of them and adding them back
+ *  - time to reconnect all the outstations after they all drop
+ *  - plugin shutdown duration
+ *
+ * Copyright (c) 2024 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Massimiliano Pinto
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+#include <memory>
+#include <thread>
+#include <chrono>
+#include <fstream>
+
+#include "outstation_simulator.h"
+#include "benchmark_plugin.h"
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "Usage: %s [options]\n"
+		"  --outstations N   number of outstations (100)\n"
+		"  --port N          TCP port of the first outstation (20000)\n"
+		"  --points N        points of each type in the outstations (10)\n"
+		"  --down N          seconds all outstations are down (5)\n"
+		"  --retry-min N     plugin minimum connection retry delay\n"
+		"  --retry-max N     plugin maximum connection retry delay\n"
+		"  --timeout N       seconds to wait for each phase (300)\n",
+		name);
+}
+
+/**
+ * Return a value in kB, or a count, from /proc/self/status
+ *
+ * @param name	The field name, i.e. VmRSS or Threads
+ * @return	The field value, 0 if not found
+ */
+static long procStatus(const string& name)
+{
+	ifstream status("/proc/self/status");
+	string line;
+	while (getline(status, line))
+	{
+		if (line.compare(0, name.length() + 1, name + ":") == 0)
+		{
+			return atol(line.c_str() + name.length() + 1);
+		}
+	}
+	return 0;
+}
+
+/**
+ * Ingest callback recording the outstations that sent data,
+ * from asset names such as dnp3_remote_20_Analog
+ */
+class FleetCounter
+{
+	public:
+		static void	ingest(void *data, Reading reading)
+		{
+			FleetCounter *counter = (FleetCounter *)data;
+			const string& asset = reading.getAssetName();
+			size_t pos = asset.find("remote_");
+			if (pos != string::npos)
+			{
+				int linkId = atoi(asset.c_str() + pos + 7);
+				lock_guard<mutex> guard(counter->m_mutex);
+				counter->m_outstations.insert(linkId);
+			}
+		};
+
+		size_t	count()
+		{
+			lock_guard<mutex> guard(m_mutex);
+			return m_outstations.size();
+		};
+
+		void	reset()
+		{
+			lock_guard<mutex> guard(m_mutex);
+			m_outstations.clear();
+		};
+
+	private:
+		mutex		m_mutex;
+		set<int>	m_outstations;
+};
+
+/**
+ * Wait until a condition is true
+ *
+ * @param done		The condition
+ * @param timeout	Maximum wait in seconds
+ * @return		Seconds waited, negative on timeout
+ */
+template<class F> static double waitFor(F done, unsigned long timeout)
+{
+	auto start = Clock::now();
+	while (!done())
+	{
+		if (Clock::now() - start > chrono::seconds(timeout))
+		{
+			return -1;
+		}
+		this_thread::sleep_for(chrono::milliseconds(5));
+	}
+	return chrono::duration<double>(Clock::now() - start).count();
+}
+
+/**
+ * Return the number of connected outstations of a range
+ */
+static size_t connected(const vector<unique_ptr<OutstationSimulator>>& outstations,
+			size_t first,
+			size_t last)
+{
+	size_t n = 0;
+	for (size_t i = first; i < last; i++)
+	{
+		if (outstations[i]->isOpen())
+		{
+			n++;
+		}
+	}
+	return n;
+}
+
+static void report(const char *phase, double seconds)
+{
+	if (seconds < 0)
+	{
+		printf("%-36s timeout\n", phase);
+	}
+	else
+	{
+		printf("%-36s %10.3f s\n", phase, seconds);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long count = 100;
+	unsigned long port = 20000;
+	unsigned long points = 10;
+	unsigned long down = 5;
+	unsigned long timeout = 300;
+	map<string, string> values;
+
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		if (i + 1 >= argc)
+		{
+			usage(argv[0]);
+			return 1;
+		}
+		const char *value = argv[++i];
+		if (arg == "--outstations")
+			count = strtoul(value, NULL, 10);
+		else if (arg == "--port")
+			port = strtoul(value, NULL, 10);
+		else if (arg == "--points")
+			points = strtoul(value, NULL, 10);
+		else if (arg == "--down")
+			down = strtoul(value, NULL, 10);
+		else if (arg == "--retry-min")
+			values["retryMin"] = value;
+		else if (arg == "--retry-max")
+			values["retryMax"] = value;
+		else if (arg == "--timeout")
+			timeout = strtoul(value, NULL, 10);
+		else
+		{
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (count == 0 || port + count > 65536 || points == 0 || points > 65535)
+	{
+		usage(argv[0]);
+		return 1;
+	}
+
+	asiodnp3::DNP3Manager manager(std::thread::hardware_concurrency());
+	vector<unique_ptr<OutstationSimulator>> outstations;
+	for (unsigned long i = 0; i < count; i++)
+	{
+		outstations.emplace_back(new OutstationSimulator(manager,
+								 port + i,
+								 10 + i,
+								 1,
+								 points,
+								 100));
+		if (!outstations.back()->start())
+		{
+			fprintf(stderr, "Unable to start the outstation on port %lu\n", port + i);
+			return 1;
+		}
+	}
+
+	// Unsolicited mode: the integrity poll is done as soon as connected
+	values["master_id"] = "1";
+	values["outstations"] = benchmarkOutstations(count, port, 10);
+	values["outstation_scan_enable"] = "true";
+	values["outstation_scan_interval"] = "3600";
+	values["dataMode"] = "Unsolicited";
+	values["readingMode"] = "Per object header";
+	values["enableTLS"] = "false";
+
+	long rss = procStatus("VmRSS");
+	long threads = procStatus("Threads");
+
+	string json = benchmarkConfig(values);
+	ConfigCategory config("benchmark", json);
+	FleetCounter counter;
+
+	auto start = Clock::now();
+	PLUGIN_HANDLE handle = plugin_init(&config);
+	if (!handle)
+	{
+		fprintf(stderr, "Plugin configuration failed\n");
+		return 1;
+	}
+	plugin_register_ingest(handle, FleetCounter::ingest, &counter);
+	plugin_start((PLUGIN_HANDLE *)handle);
+	report("Start", chrono::duration<double>(Clock::now() - start).count());
+
+	double wait = waitFor([&]() { return connected(outstations, 0, count) == count; }, timeout);
+	report("All connected after start",
+	       wait < 0 ? wait : chrono::duration<double>(Clock::now() - start).count());
+	wait = waitFor([&]() { return counter.count() == count; }, timeout);
+	report("All sent data after start",
+	       wait < 0 ? wait : chrono::duration<double>(Clock::now() - start).count());
+
+	this_thread::sleep_for(chrono::seconds(1));
+	printf("%-36s %10.1f kB\n", "Memory per outstation",
+	       (procStatus("VmRSS") - rss) / (double)count);
+	printf("%-36s %10.2f\n", "Threads per outstation",
+	       (procStatus("Threads") - threads) / (double)count);
+
+	// Scan settings change: all outstations are kept
+	values["outstation_scan_interval"] = "1800";
+	string newConfig = benchmarkConfig(values);
+	start = Clock::now();
+	plugin_reconfigure(&handle, newConfig);
+	report("Reconfigure scan settings", chrono::duration<double>(Clock::now() - start).count());
+
+	// Remove the second half of the outstations
+	size_t half = count / 2;
+	values["outstations"] = benchmarkOutstations(half, port, 10);
+	newConfig = benchmarkConfig(values);
+	start = Clock::now();
+	plugin_reconfigure(&handle, newConfig);
+	report("Reconfigure removing half", chrono::duration<double>(Clock::now() - start).count());
+	waitFor([&]() { return connected(outstations, half, count) == 0; }, timeout);
+
+	// Add them back
+	values["outstations"] = benchmarkOutstations(count, port, 10);
+	newConfig = benchmarkConfig(values);
+	start = Clock::now();
+	plugin_reconfigure(&handle, newConfig);
+	report("Reconfigure adding half", chrono::duration<double>(Clock::now() - start).count());
+	wait = waitFor([&]() { return connected(outstations, 0, count) == count; }, timeout);
+	report("All connected after adding",
+	       wait < 0 ? wait : chrono::duration<double>(Clock::now() - start).count());
+
+	// All outstations drop and come back at once
+	for (auto& o : outstations)
+	{
+		o->stop();
+	}
+	this_thread::sleep_for(chrono::seconds(down));
+	for (auto& o : outstations)
+	{
+		if (!o->start())
+		{
+			fprintf(stderr, "Unable to restart the outstation on port %u\n", o->getPort());
+		}
+	}
+	start = Clock::now();
+	counter.reset();
+	wait = waitFor([&]() { return connected(outstations, 0, count) == count; }, timeout);
+	report("All reconnected after drop", wait);
+	wait = waitFor([&]() { return counter.count() == count; }, timeout);
+	report("All sent data after drop",
+	       wait < 0 ? wait : chrono::duration<double>(Clock::now() - start).count());
+
+	start = Clock::now();
+	plugin_shutdown(handle);
+	report("Shutdown", chrono::duration<double>(Clock::now() - start).count());
+
+	for (auto& o : outstations)
+	{
+		o->stop();
+	}
+	manager.Shutdown();
+	return 0;
+}
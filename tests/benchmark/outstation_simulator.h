@@ -0,0 +1,203 @@
+#ifndef _OUTSTATION_SIMULATOR_H
+#define _OUTSTATION_SIMULATOR_H
+/*
+ * Fledge DNP3 south plugin benchmarks: loopback outstation simulator
+ *
+ * Copyright (c) 2024 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Massimiliano Pinto
+ */
+#include <string>
+#include <chrono>
+#include <memory>
+#include <atomic>
+
+#include <asiodnp3/DNP3Manager.h>
+#include <asiodnp3/IChannelListener.h>
+#include <asiodnp3/UpdateBuilder.h>
+#include <opendnp3/LogLevels.h>
+#include <opendnp3/outstation/DefaultOutstationApplication.h>
+#include <opendnp3/outstation/SimpleCommandHandler.h>
+
+/**
+ * Time origin of the simulated event values, in microseconds
+ * since the epoch: set by the first call
+ */
+static inline uint64_t simulatorEpochUs()
+{
+	static const uint64_t epoch =
+		std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::system_clock::now().time_since_epoch()).count();
+	return epoch;
+}
+
+/**
+ * Server channel listener: the channel is open while
+ * a master is connected
+ */
+class SimulatorListener : public asiodnp3::IChannelListener
+{
+	public:
+		SimulatorListener() : open(false) {};
+
+		void	OnStateChange(opendnp3::ChannelState state) override
+		{
+			open = state == opendnp3::ChannelState::OPEN;
+		};
+
+		std::atomic<bool>	open;
+};
+
+/**
+ * An opendnp3 outstation listening on a local TCP port
+ *
+ * All its analog points report Class 1 double precision events
+ * with time. The value of each event is the time it was generated,
+ * in microseconds since simulatorEpochUs(), so the receiver can
+ * measure the event to ingest latency with no clock other than
+ * its own. Values relative to the simulator start keep microsecond
+ * precision and are never out of range.
+ */
+class OutstationSimulator
+{
+	public:
+		/**
+		 * @param manager	The DNP3 manager of the simulators
+		 * @param port		The TCP port to listen on
+		 * @param linkId	The outstation link id
+		 * @param masterId	The master link id
+		 * @param points	Number of points of each type
+		 * @param events	Size of the event buffer of each type
+		 */
+		OutstationSimulator(asiodnp3::DNP3Manager& manager,
+				    uint16_t port,
+				    uint16_t linkId,
+				    uint16_t masterId,
+				    uint16_t points,
+				    uint16_t events) :
+			m_manager(manager),
+			m_port(port),
+			m_linkId(linkId),
+			m_masterId(masterId),
+			m_points(points),
+			m_events(events),
+			m_next(0),
+			m_listener(std::make_shared<SimulatorListener>())
+		{
+			simulatorEpochUs();
+		};
+
+		~OutstationSimulator()
+		{
+			this->stop();
+		};
+
+		/**
+		 * Create the TCP server channel and the outstation
+		 *
+		 * @return	True on success
+		 */
+		bool	start()
+		{
+			std::error_code ec;
+			m_channel = m_manager.AddTCPServer("simulator_" + std::to_string(m_port),
+							   opendnp3::levels::NOTHING,
+							   opendnp3::ServerAcceptMode::CloseExisting,
+							   "127.0.0.1",
+							   m_port,
+							   m_listener,
+							   ec);
+			if (ec || !m_channel)
+			{
+				return false;
+			}
+
+			opendnp3::OutstationStackConfig config(opendnp3::DatabaseSizes::AllTypes(m_points));
+			config.outstation.eventBufferConfig = opendnp3::EventBufferConfig::AllTypes(m_events);
+			config.outstation.params.allowUnsolicited = true;
+			config.link.LocalAddr = m_linkId;
+			config.link.RemoteAddr = m_masterId;
+			config.link.KeepAliveTimeout = openpal::TimeDuration::Max();
+			for (uint16_t i = 0; i < m_points; i++)
+			{
+				config.dbConfig.analog[i].clazz = opendnp3::PointClass::Class1;
+				config.dbConfig.analog[i].evariation =
+					opendnp3::EventAnalogVariation::Group32Var8;
+			}
+
+			m_outstation = m_channel->AddOutstation("outstation_" + std::to_string(m_linkId),
+								opendnp3::SuccessCommandHandler::Create(),
+								opendnp3::DefaultOutstationApplication::Create(),
+								config);
+			if (!m_outstation)
+			{
+				return false;
+			}
+			return m_outstation->Enable();
+		};
+
+		// Shutdown the outstation and its channel
+		void	stop()
+		{
+			if (m_channel)
+			{
+				m_channel->Shutdown();
+				m_channel.reset();
+				m_outstation.reset();
+				m_listener->open = false;
+			}
+		};
+
+		/**
+		 * Generate analog events, one per point in turn
+		 *
+		 * @param count	Number of events
+		 */
+		void	generate(unsigned long count)
+		{
+			if (!m_outstation || count == 0)
+			{
+				return;
+			}
+
+			auto now = std::chrono::system_clock::now().time_since_epoch();
+			double us = std::chrono::duration_cast<std::chrono::microseconds>(now).count() -
+				    simulatorEpochUs();
+			uint64_t ms = std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
+			opendnp3::Flags flags(static_cast<uint8_t>(opendnp3::AnalogQuality::ONLINE));
+
+			asiodnp3::UpdateBuilder builder;
+			for (unsigned long i = 0; i < count; i++)
+			{
+				builder.Update(opendnp3::Analog(us, flags, opendnp3::DNPTime(ms)),
+					       m_next,
+					       opendnp3::EventMode::Force);
+				m_next = (m_next + 1) % m_points;
+			}
+			m_outstation->Apply(builder.Build());
+		};
+
+		// True while a master is connected
+		bool		isOpen() const { return m_listener->open; };
+		uint16_t	getPort() const { return m_port; };
+		uint16_t	getLinkId() const { return m_linkId; };
+
+	private:
+		asiodnp3::DNP3Manager&	m_manager;
+		uint16_t		m_port;
+		uint16_t		m_linkId;
+		uint16_t		m_masterId;
+		uint16_t		m_points;
+		uint16_t		m_events;
+		uint16_t		m_next;
+		std::shared_ptr<SimulatorListener>
+					m_listener;
+		std::shared_ptr<asiodnp3::IChannel>
+					m_channel;
+		std::shared_ptr<asiodnp3::IOutstation>
+					m_outstation;
+};
+
+#endif
@@ -0,0 +1,315 @@
+/*
+ * Fledge DNP3 south plugin SOE handler micro benchmarks
+ *
+ * Synthetic object headers of every supported type are passed
+ * to dnp3SOEHandler::Process, as the master does for a response,
+ * measuring the time and the memory allocations per point.
+ * Readings are freed as soon as they are built instead of
+ * being queued for ingest, so only the handler is measured.
+ *
+ * Uses Google Benchmark if found by cmake, otherwise a simple
+ * timing loop: the optional argument is a filter on case names.
+ *
+ * Copyright (c) 2024 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Massimiliano Pinto
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <new>
+
+#ifdef HAVE_GOOGLE_BENCHMARK
+#include <benchmark/benchmark.h>
+#endif
+
+#include <logger.h>
+#include <config_category.h>
+#include <reading.h>
+#include "south_dnp3.h"
+
+using namespace std;
+using namespace opendnp3;
+using namespace asiodnp3;
+
+#define POINTS_PER_HEADER	100
+
+// Memory allocations of the process
+static std::atomic<uint64_t> allocations(0);
+
+void *operator new(size_t size)
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	void *p = malloc(size ? size : 1);
+	if (!p)
+	{
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void operator delete(void *p) noexcept
+{
+	free(p);
+}
+
+/**
+ * Object header values held in a vector
+ */
+template<class T> class VectorCollection : public ICollection<T>
+{
+	public:
+		VectorCollection(const std::vector<T>& values) : m_values(values) {};
+
+		size_t	Count() const override { return m_values.size(); };
+		void	Foreach(IVisitor<T>& visitor) const override
+		{
+			for (auto& value : m_values)
+			{
+				visitor.OnValue(value);
+			}
+		};
+
+	private:
+		const std::vector<T>&	m_values;
+};
+
+/**
+ * SOE handler processing one object header per response
+ * and freeing the readings instead of ingesting them
+ */
+class BenchmarkHandler : public dnp3SOEHandler
+{
+	public:
+		BenchmarkHandler(DNP3 *dnp3,
+				 std::string& label,
+				 const DNP3::OutStationTCP *outstation) :
+			dnp3SOEHandler(dnp3, label, outstation) {};
+
+		void	ingestReading(const std::string& assetName,
+				      std::vector<Datapoint *>& points,
+				      const std::vector<uint64_t>& eventTimes) override
+		{
+			for (Datapoint *dp : points)
+			{
+				delete dp;
+			}
+		};
+
+		template<class T> void
+			response(const HeaderInfo& info,
+				 const ICollection<Indexed<T>>& values)
+		{
+			this->Start();
+			this->Process(info, values);
+			this->End();
+		};
+};
+
+// Point values and object header variations of each type
+static void setValue(Binary& p, uint16_t i) { p.value = i & 1; }
+static void setValue(BinaryOutputStatus& p, uint16_t i) { p.value = i & 1; }
+static void setValue(DoubleBitBinary& p, uint16_t i)
+{
+	p.value = i & 1 ? DoubleBit::DETERMINED_ON : DoubleBit::DETERMINED_OFF;
+}
+static void setValue(Analog& p, uint16_t i) { p.value = i * 1.5; }
+static void setValue(AnalogOutputStatus& p, uint16_t i) { p.value = i * 1.5; }
+static void setValue(Counter& p, uint16_t i) { p.value = i; }
+
+template<class T> struct BenchmarkType;
+template<> struct BenchmarkType<Binary>
+{
+	static GroupVariation staticGv() { return GroupVariation::Group1Var2; };
+	static GroupVariation eventGv() { return GroupVariation::Group2Var2; };
+};
+template<> struct BenchmarkType<DoubleBitBinary>
+{
+	static GroupVariation staticGv() { return GroupVariation::Group3Var2; };
+	static GroupVariation eventGv() { return GroupVariation::Group4Var2; };
+};
+template<> struct BenchmarkType<BinaryOutputStatus>
+{
+	static GroupVariation staticGv() { return GroupVariation::Group10Var2; };
+	static GroupVariation eventGv() { return GroupVariation::Group11Var2; };
+};
+template<> struct BenchmarkType<Counter>
+{
+	static GroupVariation staticGv() { return GroupVariation::Group20Var1; };
+	static GroupVariation eventGv() { return GroupVariation::Group22Var5; };
+};
+template<> struct BenchmarkType<Analog>
+{
+	static GroupVariation staticGv() { return GroupVariation::Group30Var5; };
+	static GroupVariation eventGv() { return GroupVariation::Group32Var7; };
+};
+template<> struct BenchmarkType<AnalogOutputStatus>
+{
+	static GroupVariation staticGv() { return GroupVariation::Group40Var3; };
+	static GroupVariation eventGv() { return GroupVariation::Group42Var7; };
+};
+
+/**
+ * A benchmark case: one object header of a type,
+ * static or event, in a reading mode
+ */
+class BenchmarkCase
+{
+	public:
+		virtual ~BenchmarkCase() {};
+		// Process the object header once
+		virtual void	run() = 0;
+		const std::string&
+				name() const { return m_name; };
+	protected:
+		std::string	m_name;
+};
+
+template<class T> class HandlerCase : public BenchmarkCase
+{
+	public:
+		HandlerCase(const std::string& mode, bool array, bool event) :
+			m_dnp3("benchmark"),
+			m_label("remote_10"),
+			m_collection(m_values),
+			m_info(event ? BenchmarkType<T>::eventGv() : BenchmarkType<T>::staticGv(),
+			       event ? QualifierCode::UINT16_CNT_UINT16_INDEX :
+				       QualifierCode::UINT16_START_STOP,
+			       event ? TimestampMode::SYNCHRONIZED : TimestampMode::INVALID,
+			       0)
+		{
+			m_name = objectTypeName(Dnp3PointTraits<T>::type) + "/" +
+				 (array ? "Array" : mode) + "/" +
+				 (event ? "Event" : "Static");
+
+			m_dnp3.setAssetName(DEFAULT_ASSETNAME_PREFIX);
+			m_dnp3.setReadingMode(mode == "PerPoint" ?
+					      DNP3::ReadingPerPoint :
+					      mode == "PerResponse" ?
+					      DNP3::ReadingPerResponse :
+					      DNP3::ReadingPerHeader);
+			m_dnp3.setArrayDatapoints(array);
+			m_outstation.linkId = 10;
+			m_outstation.address = "127.0.0.1";
+			m_outstation.port = 20000;
+
+			uint64_t ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+				std::chrono::system_clock::now().time_since_epoch()).count();
+			for (uint16_t i = 0; i < POINTS_PER_HEADER; i++)
+			{
+				T point;
+				setValue(point, i);
+				point.flags = Flags(0x01); // Online
+				point.time = DNPTime(event ? ms : 0);
+				m_values.push_back(WithIndex(point, i));
+			}
+
+			m_handler.reset(new BenchmarkHandler(&m_dnp3, m_label, &m_outstation));
+		};
+
+		void	run() override
+		{
+			m_handler->response(m_info, m_collection);
+		};
+
+	private:
+		DNP3				m_dnp3;
+		std::string			m_label;
+		DNP3::OutStationTCP		m_outstation;
+		std::vector<Indexed<T>>		m_values;
+		VectorCollection<Indexed<T>>	m_collection;
+		HeaderInfo			m_info;
+		std::unique_ptr<BenchmarkHandler>
+						m_handler;
+};
+
+template<class T> static void
+	addCases(std::vector<std::unique_ptr<BenchmarkCase>>& cases)
+{
+	for (bool event : {false, true})
+	{
+		cases.emplace_back(new HandlerCase<T>("PerPoint", false, event));
+		cases.emplace_back(new HandlerCase<T>("PerHeader", false, event));
+		cases.emplace_back(new HandlerCase<T>("PerResponse", false, event));
+		if (Dnp3PointTraits<T>::array)
+		{
+			cases.emplace_back(new HandlerCase<T>("PerHeader", true, event));
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	Logger::getLogger()->setMinLevel("error");
+
+	std::vector<std::unique_ptr<BenchmarkCase>> cases;
+	addCases<Binary>(cases);
+	addCases<DoubleBitBinary>(cases);
+	addCases<BinaryOutputStatus>(cases);
+	addCases<Counter>(cases);
+	addCases<Analog>(cases);
+	addCases<AnalogOutputStatus>(cases);
+
+#ifdef HAVE_GOOGLE_BENCHMARK
+	for (auto& c : cases)
+	{
+		BenchmarkCase *bc = c.get();
+		benchmark::RegisterBenchmark(bc->name().c_str(), [bc](benchmark::State& state)
+		{
+			// Names are cached by the first response
+			bc->run();
+			uint64_t start = allocations;
+			for (auto _ : state)
+			{
+				bc->run();
+			}
+			double points = (double)state.iterations() * POINTS_PER_HEADER;
+			state.SetItemsProcessed(state.iterations() * POINTS_PER_HEADER);
+			state.counters["time/point"] = benchmark::Counter(points,
+				benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+			state.counters["allocs/point"] = (allocations - start) / points;
+		});
+	}
+	benchmark::Initialize(&argc, argv);
+	benchmark::RunSpecifiedBenchmarks();
+#else
+	const char *filter = argc > 1 ? argv[1] : "";
+	printf("%-40s %12s %14s\n", "Case", "ns/point", "allocs/point");
+	for (auto& c : cases)
+	{
+		if (c->name().find(filter) == string::npos)
+		{
+			continue;
+		}
+		// Names are cached by the first response
+		c->run();
+
+		uint64_t start = allocations;
+		unsigned long iterations = 0;
+		auto begin = std::chrono::steady_clock::now();
+		std::chrono::duration<double> elapsed;
+		do
+		{
+			for (int i = 0; i < 100; i++)
+			{
+				c->run();
+			}
+			iterations += 100;
+			elapsed = std::chrono::steady_clock::now() - begin;
+		} while (elapsed.count() < 0.5);
+
+		double points = (double)iterations * POINTS_PER_HEADER;
+		printf("%-40s %12.1f %14.2f\n",
+		       c->name().c_str(),
+		       elapsed.count() * 1e9 / points,
+		       (allocations - start) / points);
+	}
+#endif
+	return 0;
+}
@@ -0,0 +1,192 @@
+/*
+ * Fledge DNP3 south plugin end to end throughput benchmark
+ *
+ * A loopback outstation generates analog events at a fixed rate,
+ * the plugin is started as by the south service and the readings
+ * are counted by the ingest callback.
+ *
+ * Copyright (c) 2024 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ *
+ * Author: Massimiliano Pinto
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <chrono>
+
+#include "outstation_simulator.h"
+#include "benchmark_plugin.h"
+
+using namespace std;
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "Usage: %s [options]\n"
+		"  --points N        points of each type in the outstation (1000)\n"
+		"  --rate N          events per second (10000)\n"
+		"  --duration N      measure duration in seconds (30)\n"
+		"  --warmup N        seconds before measuring (5)\n"
+		"  --port N          outstation TCP port (20000)\n"
+		"  --mode M          data mode, Polling or Unsolicited (Unsolicited)\n"
+		"  --reading M       reading mode (Per point)\n"
+		"  --min-rate N      fail if less than N points per second are ingested\n",
+		name);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long points = 1000;
+	unsigned long rate = 10000;
+	unsigned long duration = 30;
+	unsigned long warmup = 5;
+	unsigned long port = 20000;
+	double minRate = 0;
+	string mode = "Unsolicited";
+	string readingMode = "Per point";
+
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		if (i + 1 >= argc)
+		{
+			usage(argv[0]);
+			return 1;
+		}
+		const char *value = argv[++i];
+		if (arg == "--points")
+			points = strtoul(value, NULL, 10);
+		else if (arg == "--rate")
+			rate = strtoul(value, NULL, 10);
+		else if (arg == "--duration")
+			duration = strtoul(value, NULL, 10);
+		else if (arg == "--warmup")
+			warmup = strtoul(value, NULL, 10);
+		else if (arg == "--port")
+			port = strtoul(value, NULL, 10);
+		else if (arg == "--mode")
+			mode = value;
+		else if (arg == "--reading")
+			readingMode = value;
+		else if (arg == "--min-rate")
+			minRate = atof(value);
+		else
+		{
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (points == 0 || points > 65535 || duration == 0)
+	{
+		usage(argv[0]);
+		return 1;
+	}
+
+	asiodnp3::DNP3Manager manager(1);
+	// Event buffer for one second of events
+	OutstationSimulator outstation(manager,
+				       port,
+				       10,
+				       1,
+				       points,
+				       std::min(65535UL, std::max(rate, 100UL)));
+	if (!outstation.start())
+	{
+		fprintf(stderr, "Unable to start the outstation on port %lu\n", port);
+		return 1;
+	}
+
+	string json = benchmarkConfig({
+		{"master_id", "1"},
+		{"outstations", benchmarkOutstations(1, port, 10)},
+		{"outstation_scan_enable", "true"},
+		{"outstation_scan_interval", "3600"},
+		// Event poll every second in Polling mode
+		{"event_scan_interval", mode == "Polling" ? "1" : "0"},
+		{"dataMode", mode},
+		{"readingMode", readingMode},
+		{"enableTLS", "false"}
+	});
+	ConfigCategory config("benchmark", json);
+
+	IngestCounter counter;
+	PLUGIN_HANDLE handle = plugin_init(&config);
+	if (!handle)
+	{
+		fprintf(stderr, "Plugin configuration failed\n");
+		return 1;
+	}
+	plugin_register_ingest(handle, IngestCounter::ingest, &counter);
+	plugin_start((PLUGIN_HANDLE *)handle);
+
+	// Integrity poll readings show the master is connected
+	auto connectStart = chrono::steady_clock::now();
+	while (counter.points < points)
+	{
+		if (chrono::steady_clock::now() - connectStart > chrono::seconds(30))
+		{
+			fprintf(stderr, "No integrity poll data in 30 seconds\n");
+			plugin_shutdown(handle);
+			return 1;
+		}
+		this_thread::sleep_for(chrono::milliseconds(10));
+	}
+	printf("Connected in %.3f s\n",
+	       chrono::duration<double>(chrono::steady_clock::now() - connectStart).count());
+
+	// Events at a fixed rate, applied every millisecond
+	unsigned long generated = 0;
+	auto start = chrono::steady_clock::now();
+	auto measure = start + chrono::seconds(warmup);
+	auto end = measure + chrono::seconds(duration);
+	bool measuring = false;
+	unsigned long measured = 0;
+	while (true)
+	{
+		auto now = chrono::steady_clock::now();
+		if (!measuring && now >= measure)
+		{
+			counter.reset();
+			measured = generated;
+			measuring = true;
+		}
+		if (now >= end)
+		{
+			break;
+		}
+		unsigned long due = chrono::duration<double>(now - start).count() * rate;
+		outstation.generate(due - generated);
+		generated = due;
+		this_thread::sleep_for(chrono::milliseconds(1));
+	}
+	measured = generated - measured;
+
+	// Wait for the last events
+	this_thread::sleep_for(chrono::seconds(mode == "Polling" ? 2 : 1));
+	uint64_t ingestedPoints = counter.points;
+	uint64_t ingestedReadings = counter.readings;
+	uint64_t p50 = counter.latency(50);
+	uint64_t p99 = counter.latency(99);
+
+	plugin_shutdown(handle);
+	outstation.stop();
+	manager.Shutdown();
+
+	double pointsRate = ingestedPoints / (double)duration;
+	printf("Events generated:   %lu (%lu/s)\n", measured, rate);
+	printf("Points ingested:    %lu (%.0f/s)\n", (unsigned long)ingestedPoints, pointsRate);
+	printf("Readings ingested:  %lu (%.0f/s)\n",
+	       (unsigned long)ingestedReadings,
+	       ingestedReadings / (double)duration);
+	printf("Event to ingest latency: p50 %.3f ms, p99 %.3f ms\n", p50 / 1000.0, p99 / 1000.0);
+
+	if (minRate > 0 && pointsRate < minRate)
+	{
+		fprintf(stderr, "Ingest rate %.0f points/s is lower than %.0f\n", pointsRate, minRate);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,64 @@
+#include <gtest/gtest.h>
+#include <dnp3_filter.h>
+
+using namespace std;
+
+TEST(DNP3Filter, NoDeadband)
+{
+	LastValueStore store;
+	ASSERT_FALSE(store.isEnabled(ObjectAnalog));
+	ASSERT_TRUE(store.update(ObjectAnalog, 3, 10.0, 0x01, false));
+	ASSERT_TRUE(store.update(ObjectAnalog, 3, 10.0, 0x01, false));
+}
+
+TEST(DNP3Filter, AbsoluteDeadband)
+{
+	Deadband deadband;
+	deadband.type = ObjectAnalog;
+	deadband.absolute = 1.0;
+	LastValueStore store;
+	store.setDeadbands(vector<Deadband>{deadband});
+	ASSERT_TRUE(store.isEnabled(ObjectAnalog));
+	ASSERT_FALSE(store.isEnabled(ObjectCounter));
+
+	// First value is always sent
+	ASSERT_TRUE(store.update(ObjectAnalog, 0, 10.0, 0x01, false));
+	ASSERT_FALSE(store.update(ObjectAnalog, 0, 10.5, 0x01, false));
+	ASSERT_FALSE(store.update(ObjectAnalog, 0, 9.2, 0x01, false));
+	ASSERT_TRUE(store.update(ObjectAnalog, 0, 11.5, 0x01, false));
+	// Compared to the last value sent
+	ASSERT_FALSE(store.update(ObjectAnalog, 0, 12.0, 0x01, false));
+}
+
+TEST(DNP3Filter, PercentDeadbandRange)
+{
+	Deadband deadband;
+	deadband.type = ObjectCounter;
+	deadband.start = 10;
+	deadband.stop = 19;
+	deadband.percent = 10.0;
+	LastValueStore store;
+	store.setDeadbands(vector<Deadband>{deadband});
+
+	ASSERT_TRUE(store.update(ObjectCounter, 10, 100, 0x01, false));
+	ASSERT_FALSE(store.update(ObjectCounter, 10, 105, 0x01, false));
+	ASSERT_TRUE(store.update(ObjectCounter, 10, 111, 0x01, false));
+	// Out of range index
+	ASSERT_TRUE(store.update(ObjectCounter, 20, 100, 0x01, false));
+	ASSERT_TRUE(store.update(ObjectCounter, 20, 101, 0x01, false));
+}
+
+TEST(DNP3Filter, SuppressUnchanged)
+{
+	LastValueStore store;
+	store.setSuppressUnchanged(true);
+	ASSERT_TRUE(store.isEnabled(ObjectBinary));
+
+	ASSERT_TRUE(store.update(ObjectBinary, 5, 1, 0x01, false));
+	ASSERT_FALSE(store.update(ObjectBinary, 5, 1, 0x01, false));
+	// Events are always sent
+	ASSERT_TRUE(store.update(ObjectBinary, 5, 1, 0x01, true));
+	// Changed flags
+	ASSERT_TRUE(store.update(ObjectBinary, 5, 1, 0x81, false));
+	ASSERT_TRUE(store.update(ObjectBinary, 5, 0, 0x81, false));
+}
@@ -0,0 +1,39 @@
+#include <gtest/gtest.h>
+#include <dnp3_names.h>
+#include <string>
+
+using namespace std;
+
+TEST(DNP3Names, DefaultTemplates)
+{
+	NameTemplate asset(DEFAULT_ASSET_NAME_TEMPLATE);
+	NameTemplate datapoint(DEFAULT_DATAPOINT_NAME_TEMPLATE);
+	ASSERT_EQ(asset.format(20, "127.0.0.1", 20000, "Analog", 7), "remote_20_Analog_7");
+	ASSERT_EQ(datapoint.format(20, "127.0.0.1", 20000, "Analog", 7), "Analog7");
+}
+
+TEST(DNP3Names, AllFields)
+{
+	NameTemplate t("$address$:$port$/$linkid$/$type$[$index$]");
+	ASSERT_EQ(t.format(10, "rtu1", 20001, "Binary", 3), "rtu1:20001/10/Binary[3]");
+}
+
+TEST(DNP3Names, UnknownField)
+{
+	NameTemplate t("cost$$ $x$_$index$");
+	ASSERT_EQ(t.format(10, "rtu1", 20001, "Binary", 3), "cost$$ $x$_3");
+}
+
+TEST(DNP3Names, Cache)
+{
+	NameCache cache("dnp3_", "remote_20", 20, "127.0.0.1", 20000,
+			NameTemplate(DEFAULT_ASSET_NAME_TEMPLATE),
+			NameTemplate(DEFAULT_DATAPOINT_NAME_TEMPLATE));
+	const PointNames& names = cache.get(ObjectCounter, 5);
+	ASSERT_EQ(names.asset, "dnp3_remote_20_Counter_5");
+	ASSERT_EQ(names.datapoint, "Counter5");
+	// Same entry is returned
+	ASSERT_EQ(&cache.get(ObjectCounter, 5), &names);
+	ASSERT_EQ(cache.getTypeAsset(ObjectAnalogOutput), "dnp3_remote_20_AnalogOutput");
+	ASSERT_EQ(cache.getOutstationAsset(), "dnp3_remote_20");
+}
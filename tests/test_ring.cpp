@@ -0,0 +1,69 @@
+#include <gtest/gtest.h>
+#include <dnp3_ring.h>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+TEST(DNP3Ring, PushPopOrder)
+{
+	Dnp3Ring<int> ring(4);
+	ASSERT_EQ(ring.capacity(), 4);
+	ASSERT_TRUE(ring.empty());
+	for (int i = 0; i < 4; i++)
+	{
+		ASSERT_TRUE(ring.push(i));
+	}
+	// Full
+	ASSERT_FALSE(ring.push(4));
+	ASSERT_EQ(ring.size(), 4);
+
+	int v;
+	for (int i = 0; i < 4; i++)
+	{
+		ASSERT_TRUE(ring.pop(v));
+		ASSERT_EQ(v, i);
+	}
+	// Empty
+	ASSERT_FALSE(ring.pop(v));
+}
+
+TEST(DNP3Ring, CapacityRounded)
+{
+	Dnp3Ring<int> ring(1000);
+	ASSERT_EQ(ring.capacity(), 1024);
+}
+
+TEST(DNP3Ring, MultiProducer)
+{
+	Dnp3Ring<int> ring(1024);
+	const int producers = 4;
+	const int items = 200;
+	vector<thread> threads;
+	for (int p = 0; p < producers; p++)
+	{
+		threads.push_back(thread([&ring, p, items]()
+		{
+			for (int i = 0; i < items; i++)
+			{
+				ASSERT_TRUE(ring.push(p * items + i));
+			}
+		}));
+	}
+	for (auto& t : threads)
+	{
+		t.join();
+	}
+
+	vector<bool> seen(producers * items, false);
+	int v;
+	while (ring.pop(v))
+	{
+		ASSERT_FALSE(seen[v]);
+		seen[v] = true;
+	}
+	for (bool s : seen)
+	{
+		ASSERT_TRUE(s);
+	}
+}
@@ -0,0 +1,163 @@
+#include <gtest/gtest.h>
+#include <config_category.h>
+#include <reading.h>
+#include <south_dnp3.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace opendnp3;
+using namespace asiodnp3;
+
+/**
+ * Object header values held in a vector
+ */
+template<class T> class VectorCollection : public ICollection<T>
+{
+	public:
+		VectorCollection(const vector<T>& values) : m_values(values) {};
+
+		size_t	Count() const override { return m_values.size(); };
+		void	Foreach(IVisitor<T>& visitor) const override
+		{
+			for (auto& value : m_values)
+			{
+				visitor.OnValue(value);
+			}
+		};
+
+	private:
+		const vector<T>&	m_values;
+};
+
+/**
+ * SOE handler keeping the asset and datapoint names and
+ * the number of events of the readings instead of ingesting them
+ */
+class TestHandler : public dnp3SOEHandler
+{
+	public:
+		TestHandler(DNP3 *dnp3,
+			    string& label,
+			    const DNP3::OutStationTCP *outstation) :
+			dnp3SOEHandler(dnp3, label, outstation) {};
+
+		void	ingestReading(const string& assetName,
+				      vector<Datapoint *>& points,
+				      const vector<uint64_t>& eventTimes) override
+		{
+			vector<string> names;
+			for (Datapoint *dp : points)
+			{
+				names.push_back(dp->getName());
+				delete dp;
+			}
+			readings.push_back(make_pair(assetName, names));
+			events.push_back(eventTimes.size());
+		};
+
+		// One response with the given object headers
+		void	response(const vector<pair<HeaderInfo, vector<Indexed<Analog>>>>& headers)
+		{
+			this->Start();
+			for (auto& header : headers)
+			{
+				this->Process(header.first,
+					      VectorCollection<Indexed<Analog>>(header.second));
+			}
+			this->End();
+		};
+
+		vector<pair<string, vector<string>>>
+			readings;
+		vector<size_t>	events;
+};
+
+static Indexed<Analog> analog(double value, uint16_t index)
+{
+	Analog point;
+	point.value = value;
+	point.flags = Flags(0x01); // Online
+	point.time = DNPTime(1000);
+	return WithIndex(point, index);
+}
+
+static HeaderInfo eventHeader()
+{
+	return HeaderInfo(GroupVariation::Group32Var7,
+			  QualifierCode::UINT16_CNT_UINT16_INDEX,
+			  TimestampMode::SYNCHRONIZED,
+			  0);
+}
+
+static HeaderInfo staticHeader()
+{
+	return HeaderInfo(GroupVariation::Group30Var5,
+			  QualifierCode::UINT16_START_STOP,
+			  TimestampMode::INVALID,
+			  0);
+}
+
+class DNP3SOEHandler : public ::testing::Test
+{
+	protected:
+		DNP3SOEHandler() : dnp3("test"), label("remote_10")
+		{
+			dnp3.setAssetName(DEFAULT_ASSETNAME_PREFIX);
+			outstation.linkId = 10;
+		};
+
+		DNP3			dnp3;
+		string			label;
+		DNP3::OutStationTCP	outstation;
+};
+
+// Two events of the same point are not in the same reading
+TEST_F(DNP3SOEHandler, PerHeaderSameIndexEvents)
+{
+	dnp3.setReadingMode(DNP3::ReadingPerHeader);
+	TestHandler handler(&dnp3, label, &outstation);
+
+	handler.response({{eventHeader(), {analog(1.0, 3), analog(2.0, 4), analog(3.0, 3)}}});
+
+	ASSERT_EQ(handler.readings.size(), 2);
+	ASSERT_EQ(handler.readings[0].first, "dnp3_remote_10_Analog");
+	ASSERT_EQ(handler.readings[0].second, (vector<string>{"Analog3", "Analog4"}));
+	ASSERT_EQ(handler.readings[1].first, "dnp3_remote_10_Analog");
+	ASSERT_EQ(handler.readings[1].second, (vector<string>{"Analog3"}));
+	// Event times for the latency
+	ASSERT_EQ(handler.events, (vector<size_t>{2, 1}));
+}
+
+// Static value and event of the same point in one response
+TEST_F(DNP3SOEHandler, PerOutstationStaticAndEvent)
+{
+	dnp3.setReadingMode(DNP3::ReadingPerOutstation);
+	TestHandler handler(&dnp3, label, &outstation);
+
+	handler.response({{staticHeader(), {analog(1.0, 0), analog(2.0, 1)}},
+			  {eventHeader(), {analog(3.0, 1), analog(4.0, 1)}}});
+
+	ASSERT_EQ(handler.readings.size(), 3);
+	ASSERT_EQ(handler.readings[0].first, "dnp3_remote_10");
+	ASSERT_EQ(handler.readings[0].second, (vector<string>{"Analog0", "Analog1"}));
+	ASSERT_EQ(handler.readings[1].second, (vector<string>{"Analog1"}));
+	ASSERT_EQ(handler.readings[2].second, (vector<string>{"Analog1"}));
+	ASSERT_EQ(handler.events, (vector<size_t>{0, 1, 1}));
+}
+
+// Maximum datapoints per reading and repeated names
+TEST_F(DNP3SOEHandler, PerResponseMaxDatapoints)
+{
+	dnp3.setReadingMode(DNP3::ReadingPerResponse);
+	dnp3.setMaxReadingDatapoints(2);
+	TestHandler handler(&dnp3, label, &outstation);
+
+	handler.response({{staticHeader(), {analog(1.0, 0), analog(2.0, 1), analog(3.0, 2)}},
+			  {eventHeader(), {analog(4.0, 2)}}});
+
+	ASSERT_EQ(handler.readings.size(), 3);
+	ASSERT_EQ(handler.readings[0].second, (vector<string>{"Analog0", "Analog1"}));
+	ASSERT_EQ(handler.readings[1].second, (vector<string>{"Analog2"}));
+	ASSERT_EQ(handler.readings[2].second, (vector<string>{"Analog2"}));
+}
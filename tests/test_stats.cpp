@@ -0,0 +1,34 @@
+#include <gtest/gtest.h>
+#include <dnp3_stats.h>
+
+using namespace std;
+
+TEST(DNP3Histogram, Buckets)
+{
+	ASSERT_EQ(Dnp3Histogram::bucket(0), 0);
+	ASSERT_EQ(Dnp3Histogram::bucket(1), 1);
+	ASSERT_EQ(Dnp3Histogram::bucket(3), 2);
+	ASSERT_EQ(Dnp3Histogram::bucket(4), 3);
+	ASSERT_EQ(Dnp3Histogram::bucket(UINT64_MAX), Dnp3Histogram::Buckets - 1);
+}
+
+TEST(DNP3Histogram, Percentiles)
+{
+	Dnp3Histogram histogram;
+	// 98 values of 10, 2 values of 1000
+	for (int i = 0; i < 98; i++)
+	{
+		histogram.record(10);
+	}
+	histogram.record(1000);
+	histogram.record(1000);
+
+	uint64_t counts[Dnp3Histogram::Buckets];
+	histogram.take(counts);
+	ASSERT_EQ(Dnp3Histogram::percentile(counts, 50), 15);
+	ASSERT_EQ(Dnp3Histogram::percentile(counts, 99), 1023);
+
+	// Counts have been reset
+	histogram.take(counts);
+	ASSERT_EQ(Dnp3Histogram::percentile(counts, 99), 0);
+}